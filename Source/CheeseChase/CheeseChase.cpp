@@ -3,5 +3,6 @@
 #include "CheeseChase.h"
 #include "Modules/ModuleManager.h"
 
+DEFINE_LOG_CATEGORY(LogCheeseChase);
+
 IMPLEMENT_PRIMARY_GAME_MODULE( FDefaultGameModuleImpl, CheeseChase, "CheeseChase" );
- 
\ No newline at end of file
@@ -3,3 +3,8 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Stats/Stats.h"
+
+DECLARE_LOG_CATEGORY_EXTERN(LogCheeseChase, Log, All);
+
+DECLARE_STATS_GROUP(TEXT("CheeseChase"), STATGROUP_CheeseChase, STATCAT_Advanced);
@@ -9,7 +9,9 @@
 #include "EnhancedInputSubsystems.h"
 #include "InputActionValue.h"
 #include "Tile.h"
+#include "CheeseChaseGameMode.h"
 #include "Components/SplineComponent.h"
+#include "Kismet/GameplayStatics.h"
 
 
 ACheeseChaseCharacter::ACheeseChaseCharacter()
@@ -45,11 +47,27 @@ void ACheeseChaseCharacter::BeginPlay()
 
 	if (World)
 	{
+		GameMode = Cast<ACheeseChaseGameMode>(UGameplayStatics::GetGameMode(World));
+
+		RunRecord.Seed = GameMode ? GameMode->GetRunSeed() : 0;
+		RunRecord.ConfigHash = GameMode ? GameMode->GetRunConfigHash() : 0;
+		RunStartTime = World->GetTimeSeconds();
+		LastMoveLocation = GetActorLocation();
+
 		MovementTimerDelegate.BindUFunction(this, FName("Move"));
 		World->GetTimerManager().SetTimer(MovementTimerHandle, MovementTimerDelegate, 0.001f, true);
 	}
 }
 
+void ACheeseChaseCharacter::ShiftOrigin(const FVector& Offset)
+{
+	// A teleport rather than a move, so physics isn't swept across the gap and movement doesn't follow its shifted floor a second time
+	TeleportTo(GetActorLocation() + Offset, GetActorRotation(), false, true);
+
+	// Keep the travelled distance from picking up the shift
+	LastMoveLocation += Offset;
+}
+
 void ACheeseChaseCharacter::SetupPlayerInputComponent(UInputComponent* PlayerInputComponent)
 {
 	// Add Input Mapping Context
@@ -100,18 +118,124 @@ void ACheeseChaseCharacter::ChooseLane(const FInputActionValue& Value)
 		break;
 	}
 
+	if (UWorld* World = GetWorld())
+	{
+		FRunInput& Input = RunRecord.Inputs.AddDefaulted_GetRef();
+		Input.Time = World->GetTimeSeconds() - RunStartTime;
+		Input.Type = ERunInputType::ChooseLane;
+		Input.Value = Direction;
+	}
+
+	if (NewLane != MovementLane)
+	{
+		LaneSwitchStartDistance = RunRecord.Distance;
+		bIsSwitchingLane = true;
+	}
+
 	SetMovementLane(NewLane);
 }
 
+void ACheeseChaseCharacter::SetCurrentTile(ATile* NewTile)
+{
+	if (NewTile && NewTile != CurrentTile)
+	{
+		TileMix[static_cast<uint8>(NewTile->GetNextAttachLocation())]++;
+	}
+
+	// The run proper starts on landing, after however long the fall from the player start took
+	if (NewTile && !CurrentTile && RunRecord.Distance <= 0.0f)
+	{
+		FVector ActorLocation = GetActorLocation();
+		USplineComponent* MiddleSpline = NewTile->GetLaneSpline(ETileLane::Middle);
+
+		RunRecord.StartTime = GetWorld() ? GetWorld()->GetTimeSeconds() - RunStartTime : 0.0f;
+		RunRecord.StartDistance = MiddleSpline ? MiddleSpline->GetDistanceAlongSplineAtLocation(ActorLocation, ESplineCoordinateSpace::World) : 0.0f;
+		LastMoveLocation = ActorLocation;
+	}
+
+	CurrentTile = NewTile;
+}
+
+float ACheeseChaseCharacter::GetLaneSwitchDistance(float LaneSpacing) const
+{
+	float Clearance = FMath::Max(GetCapsuleComponent()->GetUnscaledCapsuleRadius(), 1.0f);
+	const UCharacterMovementComponent* Movement = GetCharacterMovement();
+
+	float SteeringDistance = SteeringLookahead * FMath::Loge(FMath::Max(LaneSpacing / Clearance, 1.0f));
+	float TurnDistance = Movement->GroundFriction > KINDA_SMALL_NUMBER ? Movement->MaxWalkSpeed / Movement->GroundFriction : 0.0f;
+
+	return SteeringDistance + TurnDistance;
+}
+
+FRunRecord ACheeseChaseCharacter::GetRunRecord() const
+{
+	FRunRecord Record = RunRecord;
+
+	if (UWorld* World = GetWorld())
+	{
+		Record.Duration = World->GetTimeSeconds() - RunStartTime;
+	}
+
+	Record.Score = CurrentTile ? FMath::Max(CurrentTile->GetTileIndex(), 0) : 0;
+	return Record;
+}
+
+bool ACheeseChaseCharacter::SaveRunRecord(const FString& Name) const
+{
+	return GetRunRecord().SaveToFile(FPaths::ProjectSavedDir() / TEXT("Runs") / Name + FRunRecord::FileExtension);
+}
+
+FRunResult ACheeseChaseCharacter::GetRunResult() const
+{
+	FRunRecord Record = GetRunRecord();
+	FRunResult Result;
+
+	Result.Seed = Record.Seed;
+	Result.Score = Record.Score;
+	Result.Distance = Record.Distance;
+	Result.Duration = Record.Duration;
+	Result.StraightTiles = TileMix[static_cast<uint8>(ETileAttachLocation::Forward)];
+	Result.LeftCornerTiles = TileMix[static_cast<uint8>(ETileAttachLocation::Left)];
+	Result.RightCornerTiles = TileMix[static_cast<uint8>(ETileAttachLocation::Right)];
+
+	return Result;
+}
+
 void ACheeseChaseCharacter::Move()
 {
 	if (!CurrentTile) return;
 
 	FVector ActorLocation = GetActorLocation();
+	RunRecord.Distance += FVector::Dist2D(ActorLocation, LastMoveLocation);
+	LastMoveLocation = ActorLocation;
+	
 	USplineComponent* MovementSpline = CurrentTile->GetLaneSpline(MovementLane);
 	
 	float DistanceAlong = MovementSpline->GetDistanceAlongSplineAtLocation(ActorLocation, ESplineCoordinateSpace::World);
-	FVector TargetLocation = MovementSpline->GetWorldLocationAtDistanceAlongSpline(DistanceAlong + 100.0f);
+
+	// Obstacle layouts leave lane changes GetLaneSwitchDistance of room, so the steering below has to settle within it
+	if (bIsSwitchingLane && RunRecord.Distance - LaneSwitchStartDistance >= GetLaneSwitchDistance(ATile::GetLaneSpacing(CurrentTile->GetFloorBounds(), CurrentTile->GetLaneSpacingMultiplier())))
+	{
+		bIsSwitchingLane = false;
+
+		float LaneOffset = FVector::Dist2D(ActorLocation, MovementSpline->FindLocationClosestToWorldLocation(ActorLocation, ESplineCoordinateSpace::World));
+		ensureMsgf(LaneOffset <= GetCapsuleComponent()->GetUnscaledCapsuleRadius() + 1.0f, TEXT("Lane change still %.1f off the lane after its switch distance"), LaneOffset);
+	}
+
+	float TargetDistance = DistanceAlong + SteeringLookahead;
+	USplineComponent* TargetSpline = MovementSpline;
+
+	// Look past the end of this tile onto the next one in the shared chain
+	if (TargetDistance > MovementSpline->GetSplineLength() && GameMode)
+	{
+		if (ATile* NextTile = GameMode->GetTile(CurrentTile->GetTileIndex() + 1))
+		{
+			TargetDistance -= MovementSpline->GetSplineLength();
+			TargetSpline = NextTile->GetLaneSpline(MovementLane);
+		}
+	}
+	
+	FVector TargetLocation = TargetSpline->GetWorldLocationAtDistanceAlongSpline(TargetDistance);
 	FRotator TargetRotation = MovementSpline->GetWorldRotationAtDistanceAlongSpline(DistanceAlong);
 
 	FVector Direction = (TargetLocation - ActorLocation).GetSafeNormal();
@@ -5,6 +5,8 @@
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
 #include "Logging/LogMacros.h"
+#include "CheeseChaseSaveSubsystem.h"
+#include "RunRecord.h"
 #include "CheeseChaseCharacter.generated.h"
 
 class USpringArmComponent;
@@ -48,7 +50,7 @@ public:
 	FORCEINLINE class ATile* GetCurrentTile() const { return CurrentTile; }
 
 	UFUNCTION(BlueprintCallable)
-	FORCEINLINE void SetCurrentTile(class ATile* NewTile) { CurrentTile = NewTile; }
+	void SetCurrentTile(class ATile* NewTile);
 
 	UFUNCTION(BlueprintPure)
 	FORCEINLINE ETileLane GetMovementLane() const { return MovementLane; }
@@ -56,6 +58,28 @@ public:
 	UFUNCTION(BlueprintCallable)
 	FORCEINLINE void SetMovementLane(ETileLane TileLane) { MovementLane = TileLane; }
 
+	// How far along the lane Move steers ahead of the runner
+	static constexpr float SteeringLookahead = 100.0f;
+
+	// Track distance Move takes to change over lanes LaneSpacing apart. It steers for a point SteeringLookahead along the
+	// new lane, so the offset from it shrinks as exp(-Distance / SteeringLookahead), and ground friction takes another
+	// MaxWalkSpeed / GroundFriction to swing the velocity round. Done once the capsule is within its radius of the new lane.
+	float GetLaneSwitchDistance(float LaneSpacing) const;
+
+	// Teleports the runner along with the track when the game mode rebases it, without counting it as distance run
+	void ShiftOrigin(const FVector& Offset);
+
+	// Snapshot of the run so far, enough to verify it offline
+	FRunRecord GetRunRecord() const;
+
+	// Writes the run so far under Saved/Runs
+	UFUNCTION(BlueprintCallable)
+	bool SaveRunRecord(const FString& Name) const;
+
+	// Summary of the run so far for the leaderboard
+	UFUNCTION(BlueprintPure)
+	FRunResult GetRunResult() const;
+
 private:
 	FTimerHandle MovementTimerHandle;
 	FTimerDelegate MovementTimerDelegate;
@@ -63,6 +87,21 @@ private:
 	UPROPERTY()
 	class ATile* CurrentTile = nullptr;
 
+	UPROPERTY()
+	class ACheeseChaseGameMode* GameMode = nullptr;
+
 	ETileLane MovementLane;
+
+	FRunRecord RunRecord;
+
+	// Tiles entered, indexed by ETileAttachLocation
+	int32 TileMix[3] = {};
+
+	float RunStartTime = 0.0f;
+	FVector LastMoveLocation = FVector::ZeroVector;
+
+	// Run distance the last lane change started at, Move checks it lands within GetLaneSwitchDistance
+	float LaneSwitchStartDistance = 0.0f;
+	bool bIsSwitchingLane = false;
 };
 
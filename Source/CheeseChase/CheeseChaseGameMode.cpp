@@ -2,79 +2,301 @@
 
 #include "CheeseChaseGameMode.h"
 
+#include "CheeseChase.h"
+#include "CheeseChaseCharacter.h"
+#include "RunVerifier.h"
 #include "Tile.h"
+#include "Components/SplineComponent.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Kismet/GameplayStatics.h"
 #include "UObject/ConstructorHelpers.h"
 
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Generation Horizon (s)"), STAT_GenerationHorizon, STATGROUP_CheeseChase);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Spawn Debt (tiles)"), STAT_SpawnDebt, STATGROUP_CheeseChase);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Average Tile Spawn Cost (ms)"), STAT_AverageTileSpawnCost, STATGROUP_CheeseChase);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Spawns Held By Live Tile Cap"), STAT_HeldSpawns, STATGROUP_CheeseChase);
+DECLARE_CYCLE_STAT(TEXT("Spawn Tile"), STAT_SpawnTile, STATGROUP_CheeseChase);
+
+// Room left under the live tile cap for the horizon to stretch past LookaheadSeconds while spawns are expensive
+static constexpr float HorizonSlackSeconds = 1.0f;
+
 ACheeseChaseGameMode::ACheeseChaseGameMode()
 {
+	PrimaryActorTick.bCanEverTick = true;
 }
 
 void ACheeseChaseGameMode::BeginPlay()
 {
 	Super::BeginPlay();
 
+	SpawnLocalPlayers();
+
+	RunSeed = Seed != 0 ? Seed : FMath::Rand();
+	TrackGenerator = CreateTrackGenerator(RunSeed);
+
+	// Runs are verified at the default pawn's speed, the same one the commandlet reads
+	const ACheeseChaseCharacter* DefaultCharacter = DefaultPawnClass ? Cast<ACheeseChaseCharacter>(DefaultPawnClass->GetDefaultObject()) : nullptr;
+	float RunSpeed = DefaultCharacter ? DefaultCharacter->GetCharacterMovement()->MaxWalkSpeed : 0.0f;
+	RunConfigHash = FRunVerifier::GetConfigHash(TrackGenerator, RunSpeed);
+
+	// The cap only holds spawns back, a horizon that needs more tiles than it allows runs short of track at full speed
+	float ShortestTileLength = TrackGenerator.GetShortestTileLength();
+	int32 HorizonTiles = ShortestTileLength > 0.0f ? StartingTiles + TilesBehind + FMath::CeilToInt32(RunSpeed * (LookaheadSeconds + HorizonSlackSeconds) / ShortestTileLength) : 0;
+
+	if (HorizonTiles > GetLiveTileCap())
+	{
+		UE_LOG(LogCheeseChase, Warning, TEXT("Generation horizon can need %d live tiles at %.0f speed, only %d are allowed"), HorizonTiles, RunSpeed, GetLiveTileCap());
+	}
+
 	NextTileTransform = FTransform::Identity;
 	SpawnTiles(StartingTiles);
 }
 
-// I FUCKING LOVE RECURSION!!!!!
-void ACheeseChaseGameMode::SpawnTiles(int32 Num)
+void ACheeseChaseGameMode::Tick(float DeltaSeconds)
 {
-	UWorld* World = GetWorld();
-	if (!World) return;
+	Super::Tick(DeltaSeconds);
 
-	TSubclassOf<ATile> TileClass = SpawningTileClass;
-	
-	if (!IsFirstTile)
-	{
-		TArray<TSubclassOf<ATile>> SortedTileClasses;
+	if (bCheckRebase) RebaseOrigin();
+
+	int32 MinTileIndex = 0;
+	int32 MaxTileIndex = 0;
+	GetPlayerProgress(MinTileIndex, MaxTileIndex);
 
-		for (const TPair<TSubclassOf<ATile>, ETileRarity>& Pair : TilePrefabs)
+	// Whatever frames it takes to pay for a tile out of the budget, the leader keeps running through
+	float SpawnFrames = FMath::Max(1.0f, FMath::CeilToFloat(AverageSpawnCost / SpawnBudgetSeconds));
+	GenerationHorizon = LookaheadSeconds + SpawnFrames * DeltaSeconds;
+
+	// Every player shares the one chain, so it only needs to reach past the leader
+	double MissingDistance = GetLeadingSpeed() * GenerationHorizon - GetDistanceAhead(MaxTileIndex);
+	double AverageTileLength = Tiles.IsEmpty() ? 0.0 : (GeneratedDistance - TileDistances[0]) / Tiles.Num();
+
+	SpawnDebt = AverageTileLength > KINDA_SMALL_NUMBER ? FMath::Max(0, FMath::CeilToInt32(MissingDistance / AverageTileLength)) : 0;
+
+	double FrameStartTime = FPlatformTime::Seconds();
+
+	while (SpawnDebt > 0)
+	{
+		// Wait for the trailing player to free some tiles rather than go past the cap
+		if (Tiles.Num() >= GetLiveTileCap())
 		{
-			for (uint32 Index = 0; Index < static_cast<uint8>(Pair.Value); Index++)
-			{
-				SortedTileClasses.Add(Pair.Key);
-			}
+			INC_DWORD_STAT(STAT_HeldSpawns);
+			if (!bHasHeldSpawns) UE_LOG(LogCheeseChase, Warning, TEXT("Holding tile spawns at %d live tiles"), Tiles.Num());
+
+			bHasHeldSpawns = true;
+			break;
 		}
-		if (!SortedTileClasses.IsEmpty()) TileClass = SortedTileClasses[FMath::RandRange(0, SortedTileClasses.Num() - 1)];
+
+		double SpawnStartTime = FPlatformTime::Seconds();
+		if (!SpawnTile()) break;
+
+		double Now = FPlatformTime::Seconds();
+		AverageSpawnCost = AverageSpawnCost > 0.0 ? FMath::Lerp(AverageSpawnCost, Now - SpawnStartTime, 0.1) : Now - SpawnStartTime;
+		SpawnDebt--;
+
+		// Leave the rest for later frames rather than run over the budget
+		if (Now - FrameStartTime + AverageSpawnCost > SpawnBudgetSeconds) break;
 	}
 
-	if (!TileClass) return;
+	SET_FLOAT_STAT(STAT_GenerationHorizon, GenerationHorizon);
+	SET_DWORD_STAT(STAT_SpawnDebt, SpawnDebt);
+	SET_FLOAT_STAT(STAT_AverageTileSpawnCost, AverageSpawnCost * 1000.0);
+}
+
+void ACheeseChaseGameMode::UpdateTrack()
+{
+	int32 MinTileIndex = 0;
+	int32 MaxTileIndex = 0;
+	GetPlayerProgress(MinTileIndex, MaxTileIndex);
 
-	FActorSpawnParameters SpawnParams;
-	ATile* NextTile = World->SpawnActorDeferred<ATile>(TileClass->GetAuthoritativeClass(), NextTileTransform);
+	PurgeTiles(MinTileIndex - TilesBehind);
+	bCheckRebase = true;
+}
 
-	if (NextTile)
+void ACheeseChaseGameMode::RebaseOrigin()
+{
+	bCheckRebase = false;
+
+	UWorld* World = GetWorld();
+	if (!World || RebaseDistance <= 0.0f || Tiles.IsEmpty() || !Tiles[0]) return;
+
+	FVector TrailingLocation = Tiles[0]->GetActorLocation();
+	if (TrailingLocation.Size2D() < RebaseDistance) return;
+
+	// Moved by hand rather than through UWorld::SetNewWorldOrigin, which leaves Chaos bodies where they were.
+	// Only ever happens on a tile boundary with a handful of live actors, so teleporting them all is cheap.
+	// The track generator works in its own track space and tile distances are along the chain, neither moves.
+	FVector Offset(-FMath::RoundToDouble(TrailingLocation.X), -FMath::RoundToDouble(TrailingLocation.Y), 0.0);
+
+	for (TArray<ATile*>* TileArray : { &Tiles, &TilePool })
 	{
-		if (NextTile->IsCorner())
+		for (ATile* Tile : *TileArray)
 		{
-			if (CornerBuffer > 0)
-			{
-				NextTile->Destroy();
-				SpawnTiles(Num);
-				return;
-			}
-			CornerBuffer = MaxCornerBuffer;
+			if (Tile) Tile->SetActorLocation(Tile->GetActorLocation() + Offset, false, nullptr, ETeleportType::TeleportPhysics);
 		}
-		
-		NextTile->FinishSpawning(NextTileTransform);
-		NextTileTransform = NextTile->GetNextAttachTransform();
-		CornerBuffer--;
+	}
+
+	NextTileTransform.AddToTranslation(Offset);
+
+	// Players go last so they land back on tiles that have already moved under them
+	for (FConstPlayerControllerIterator Iterator = World->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		ACheeseChaseCharacter* Player = Iterator->IsValid() ? Cast<ACheeseChaseCharacter>((*Iterator)->GetPawn()) : nullptr;
+		if (Player) Player->ShiftOrigin(Offset);
+	}
+}
+
+int32 ACheeseChaseGameMode::GetLiveTileCap() const
+{
+	// Tiles older than the history could have new ones laid over them
+	return FMath::Min(MaxLiveTiles, TrackGenerator.GetOccupancyHistory());
+}
+
+ATile* ACheeseChaseGameMode::GetTile(int32 TileIndex) const
+{
+	int32 Offset = TileIndex - FirstTileIndex;
+	return Tiles.IsValidIndex(Offset) ? Tiles[Offset] : nullptr;
+}
+
+FTrackGenerator ACheeseChaseGameMode::CreateTrackGenerator(int32 GeneratorSeed) const
+{
+	FTrackGenerator Generator;
+	Generator.SetStartingTileClass(SpawningTileClass);
 
-		Tiles.Add(NextTile);
-		PurgeTiles();
+	for (const TPair<TSubclassOf<ATile>, ETileRarity>& Pair : TilePrefabs)
+	{
+		Generator.AddTileClass(Pair.Key, static_cast<uint8>(Pair.Value));
 	}
 
-	IsFirstTile = false;
+	// Fixed so a seed always lays out the same track, live tiles are kept within it by GetLiveTileCap instead
+	Generator.SetOccupancyHistory(OccupancyHistory);
+
+	const ACheeseChaseCharacter* DefaultCharacter = DefaultPawnClass ? Cast<ACheeseChaseCharacter>(DefaultPawnClass->GetDefaultObject()) : nullptr;
+
+	// Lane changes take as long as the default runner really needs to steer across each tile's lanes
+	Generator.SetObstacleRules(ObstacleDensity, [DefaultCharacter](float LaneSpacing)
+	{
+		return DefaultCharacter ? DefaultCharacter->GetLaneSwitchDistance(LaneSpacing) : 0.0f;
+	});
+	Generator.Reset(GeneratorSeed, MaxCornerBuffer);
+	return Generator;
+}
+
+void ACheeseChaseGameMode::SpawnLocalPlayers()
+{
+	// The first local player is created by the engine, split-screen players are added on top of it
+	for (int32 Index = UGameplayStatics::GetNumLocalPlayerControllers(this); Index < LocalPlayerCount; Index++)
+	{
+		UGameplayStatics::CreatePlayer(this, -1, true);
+	}
+}
+
+// I FUCKING LOVE RECURSION!!!!!
+void ACheeseChaseGameMode::SpawnTiles(int32 Num)
+{
+	if (!SpawnTile()) return;
 	if (Num > 1) SpawnTiles(Num - 1);
 }
 
-void ACheeseChaseGameMode::PurgeTiles()
+bool ACheeseChaseGameMode::SpawnTile()
+{
+	SCOPE_CYCLE_COUNTER(STAT_SpawnTile);
+
+	UWorld* World = GetWorld();
+	if (!World) return false;
+
+	const FTrackTileInfo* TileInfo = TrackGenerator.Next();
+	if (!TileInfo) return false;
+
+	ATile* NextTile = AcquireTile(TileInfo->TileClass, NextTileTransform);
+	if (!NextTile) return false;
+
+	NextTileTransform = NextTile->GetNextAttachTransform();
+	NextTile->SetObstacles(TrackGenerator.GetObstacles());
+
+	NextTile->SetTileIndex(FirstTileIndex + Tiles.Num());
+	Tiles.Add(NextTile);
+
+	TileDistances.Add(GeneratedDistance);
+	GeneratedDistance += NextTile->GetLaneSpline(ETileLane::Middle)->GetSplineLength();
+
+	return true;
+}
+
+void ACheeseChaseGameMode::PurgeTiles(int32 KeepFromIndex)
 {
-	if (Tiles.Num() > TileLimit)
+	while (!Tiles.IsEmpty() && FirstTileIndex < KeepFromIndex)
 	{
-		ATile* Tile = Tiles[0];
-		Tile->Destroy();
+		ReleaseTile(Tiles[0]);
 		Tiles.RemoveAt(0);
+		TileDistances.RemoveAt(0);
+		FirstTileIndex++;
+	}
+}
+
+void ACheeseChaseGameMode::GetPlayerProgress(int32& OutMinTileIndex, int32& OutMaxTileIndex) const
+{
+	OutMinTileIndex = MAX_int32;
+	OutMaxTileIndex = FirstTileIndex;
+
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		// Dead, unpossessed or respawning players don't hold the track back
+		ACheeseChaseCharacter* Player = Iterator->IsValid() ? Cast<ACheeseChaseCharacter>((*Iterator)->GetPawn()) : nullptr;
+		if (!Player) continue;
+
+		// A runner that hasn't landed yet is still waiting at the start of the track
+		int32 PlayerTileIndex = Player->GetCurrentTile() ? Player->GetCurrentTile()->GetTileIndex() : FirstTileIndex;
+
+		OutMinTileIndex = FMath::Min(OutMinTileIndex, PlayerTileIndex);
+		OutMaxTileIndex = FMath::Max(OutMaxTileIndex, PlayerTileIndex);
+	}
+
+	if (OutMinTileIndex == MAX_int32) OutMinTileIndex = FirstTileIndex;
+}
+
+float ACheeseChaseGameMode::GetLeadingSpeed() const
+{
+	float LeadingSpeed = 0.0f;
+
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		ACheeseChaseCharacter* Player = Iterator->IsValid() ? Cast<ACheeseChaseCharacter>((*Iterator)->GetPawn()) : nullptr;
+		if (!Player) continue;
+
+		// Runners are always trying to move at full speed, so plan for that rather than a momentary stumble
+		LeadingSpeed = FMath::Max3(LeadingSpeed, Player->GetVelocity().Size2D(), Player->GetCharacterMovement()->GetMaxSpeed());
+	}
+
+	return LeadingSpeed;
+}
+
+double ACheeseChaseGameMode::GetDistanceAhead(int32 TileIndex) const
+{
+	int32 Offset = TileIndex - FirstTileIndex + 1;
+	return TileDistances.IsValidIndex(Offset) ? GeneratedDistance - TileDistances[Offset] : 0.0;
+}
+
+ATile* ACheeseChaseGameMode::AcquireTile(TSubclassOf<ATile> TileClass, const FTransform& Transform)
+{
+	for (int32 Index = 0; Index < TilePool.Num(); Index++)
+	{
+		ATile* PooledTile = TilePool[Index];
+
+		if (PooledTile && PooledTile->GetClass() == TileClass)
+		{
+			TilePool.RemoveAtSwap(Index);
+			PooledTile->Activate(Transform);
+			return PooledTile;
+		}
 	}
+
+	return GetWorld()->SpawnActor<ATile>(TileClass->GetAuthoritativeClass(), Transform);
+}
+
+void ACheeseChaseGameMode::ReleaseTile(ATile* Tile)
+{
+	if (!Tile) return;
+
+	Tile->Deactivate();
+	TilePool.Add(Tile);
 }
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/GameModeBase.h"
+#include "TrackGenerator.h"
 #include "CheeseChaseGameMode.generated.h"
 
 UENUM(BlueprintType)
@@ -27,10 +28,47 @@ protected:
 	virtual void BeginPlay() override;
 
 public:
-	void SpawnTiles(int32 Num);
+	virtual void Tick(float DeltaSeconds) override;
+
+	// Purges behind the trailing player, generation ahead of the leader is paced from Tick
+	void UpdateTrack();
+
+	// Seconds of travel the track is generated ahead of the leading player
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE float GetGenerationHorizon() const { return GenerationHorizon; }
+
+	// Tiles still owed to reach the horizon, paid off over the next frames
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE int32 GetSpawnDebt() const { return SpawnDebt; }
+
+	// O(1) lookup into the shared tile chain, nullptr if the tile is not live
+	class ATile* GetTile(int32 TileIndex) const;
+
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE int32 GetRunSeed() const { return RunSeed; }
+
+	// Identifies the track config runs are recorded against, see FRunVerifier::GetConfigHash
+	FORCEINLINE uint32 GetRunConfigHash() const { return RunConfigHash; }
+
+	// Generator producing the same tile sequence as a run of this game mode with the given seed
+	FTrackGenerator CreateTrackGenerator(int32 GeneratorSeed) const;
 
 private:
-	void PurgeTiles();
+	void SpawnLocalPlayers();
+	void SpawnTiles(int32 Num);
+	bool SpawnTile();
+	void PurgeTiles(int32 KeepFromIndex);
+	void GetPlayerProgress(int32& OutMinTileIndex, int32& OutMaxTileIndex) const;
+	float GetLeadingSpeed() const;
+	int32 GetLiveTileCap() const;
+
+	// Track length generated past the end of the given tile
+	double GetDistanceAhead(int32 TileIndex) const;
+
+	void RebaseOrigin();
+
+	class ATile* AcquireTile(TSubclassOf<class ATile> TileClass, const FTransform& Transform);
+	void ReleaseTile(class ATile* Tile);
 
 private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true"))
@@ -39,16 +77,71 @@ private:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true"))
 	TMap<TSubclassOf<class ATile>, ETileRarity> TilePrefabs;
 
+	// How many of the most recent tiles new tiles are kept from overlapping. Part of the layout, changing it changes every seed's track.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true", ClampMin = "1", UIMin = "1"))
+	int32 OccupancyHistory = 64;
+
+	// Most tiles kept live at once, spawning waits on the trailing player past it. Never more than the occupancy history,
+	// older tiles than that could have new ones laid over them.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true", ClampMin = "1", UIMin = "1"))
+	int32 MaxLiveTiles = 64;
+
+	// Chance for each lane of each obstacle slot to be blocked, before the solver opens a way through
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Obstacles", meta = (AllowPrivateAccess = "true", ClampMin = "0", UIMin = "0", ClampMax = "1", UIMax = "1"))
+	float ObstacleDensity = 0.0f;
+
+	// Seconds of running the track is kept generated ahead of the leading player
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true", ClampMin = "0", UIMin = "0"))
+	float LookaheadSeconds = 6.0f;
+
+	// Game thread time tile generation may take each frame, at least one tile is spawned while in debt
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true", ClampMin = "0.0001", UIMin = "0.0001"))
+	float SpawnBudgetSeconds = 0.002f;
+
+	// Once the oldest live tile is this far from the origin the track and players are shifted back onto it, zero never rebases
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true", ClampMin = "0", UIMin = "0"))
+	float RebaseDistance = 200000.0f;
+
+	// Zero rolls a new seed every run
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Tiles", meta = (AllowPrivateAccess = "true"))
+	int32 Seed = 0;
+
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Players", meta = (AllowPrivateAccess = "true", ClampMin = "1", UIMin = "1", ClampMax = "4", UIMax = "4"))
+	int32 LocalPlayerCount = 1;
+
 	UPROPERTY()
 	TArray<class ATile*> Tiles;
+
+	UPROPERTY()
+	TArray<class ATile*> TilePool;
+
+	// Chain index of Tiles[0]
+	int32 FirstTileIndex = 0;
+
+	// Middle lane distance along the chain at the start of each live tile, and at the end of the last one
+	TArray<double> TileDistances;
+	double GeneratedDistance = 0.0;
+
+	double AverageSpawnCost = 0.0;
+	float GenerationHorizon = 0.0f;
+	int32 SpawnDebt = 0;
+
+	// Set once spawning has had to wait on MaxLiveTiles, only the first wait is logged
+	bool bHasHeldSpawns = false;
+
+	// Set when a player crosses onto a new tile, the rebase itself waits for Tick to stay out of overlap dispatch
+	bool bCheckRebase = false;
 	
 	FTransform NextTileTransform;
-	bool IsFirstTile = true;
+	FTrackGenerator TrackGenerator;
+	int32 RunSeed = 0;
+	uint32 RunConfigHash = 0;
 	int32 MaxCornerBuffer = 3;
-	int32 CornerBuffer = MaxCornerBuffer;
 
 	uint8 StartingTiles = 5;
 	uint8 TileLimit = StartingTiles+1;
+
+	int32 TilesBehind = TileLimit-StartingTiles;
 };
 
 
@@ -0,0 +1,271 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "CheeseChaseSaveSubsystem.h"
+
+#include "CheeseChase.h"
+#include "Async/Async.h"
+#include "HAL/FileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+
+static constexpr uint32 LeaderboardMagic = 0x424C4343; // "CCLB"
+static constexpr uint16 LeaderboardVersion = 2;
+static constexpr int64 LeaderboardHeaderSize = 8;
+static constexpr int64 LeaderboardRecordSize = 32;
+
+// Serialized run fields come first, the rest of the record is a checksum of them
+static constexpr int64 LeaderboardChecksumOffset = 30;
+
+// Records read from disk per chunk while streaming the leaderboard
+static constexpr int64 LeaderboardChunkRecords = 256;
+
+static uint16 ToTileCount(int32 Count)
+{
+	return static_cast<uint16>(FMath::Clamp(Count, 0, static_cast<int32>(MAX_uint16)));
+}
+
+FArchive& operator<<(FArchive& Ar, FRunResult& Result)
+{
+	uint16 StraightTiles = ToTileCount(Result.StraightTiles);
+	uint16 LeftCornerTiles = ToTileCount(Result.LeftCornerTiles);
+	uint16 RightCornerTiles = ToTileCount(Result.RightCornerTiles);
+	int64 Ticks = Result.Timestamp.GetTicks();
+
+	Ar << Result.Seed << Result.Score << Result.Distance << Result.Duration;
+	Ar << StraightTiles << LeftCornerTiles << RightCornerTiles;
+	Ar << Ticks;
+
+	if (Ar.IsLoading())
+	{
+		Result.StraightTiles = StraightTiles;
+		Result.LeftCornerTiles = LeftCornerTiles;
+		Result.RightCornerTiles = RightCornerTiles;
+		Result.Timestamp = FDateTime(Ticks);
+	}
+
+	return Ar;
+}
+
+static uint16 GetRecordChecksum(const uint8* Record)
+{
+	return static_cast<uint16>(FCrc::MemCrc32(Record, static_cast<int32>(LeaderboardChecksumOffset)));
+}
+
+static bool IsBetterRun(const FRunResult& A, const FRunResult& B)
+{
+	return A.Score != B.Score ? A.Score > B.Score : A.Distance > B.Distance;
+}
+
+void UCheeseChaseSaveSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	// Loaded in the background so the main menu comes up straight away
+	QueryTopRuns(TopRunCount);
+}
+
+void UCheeseChaseSaveSubsystem::Deinitialize()
+{
+	// Flush queued writes, nothing is waiting on reads any more
+	SavePipe.WaitUntilEmpty();
+
+	Super::Deinitialize();
+}
+
+int32 UCheeseChaseSaveSubsystem::SubmitRun(const FRunResult& Result)
+{
+	FRunResult Run = Result;
+	if (Run.Timestamp.GetTicks() == 0) Run.Timestamp = FDateTime::UtcNow();
+
+	// Still cached and merged with the query once it lands, there's just nothing to rank it against yet
+	int32 Rank = InsertTopRun(Run);
+	if (!bTopRunsLoaded) Rank = INDEX_NONE;
+
+	RunsSinceQuery.Add(Run);
+
+	TArray<uint8> Record;
+	FMemoryWriter Writer(Record);
+	Writer << Run;
+
+	check(Record.Num() == LeaderboardChecksumOffset);
+	uint16 Checksum = GetRecordChecksum(Record.GetData());
+	Writer << Checksum;
+
+	SavePipe.Launch(UE_SOURCE_LOCATION, [Path = GetLeaderboardPath(), Record = MoveTemp(Record)]()
+	{
+		AppendRecord(Path, Record);
+	});
+
+	return Rank;
+}
+
+void UCheeseChaseSaveSubsystem::QueryTopRuns(int32 Count)
+{
+	TopRunCount = FMath::Max(Count, 1);
+	RunsSinceQuery.Reset();
+
+	TWeakObjectPtr<UCheeseChaseSaveSubsystem> WeakThis(this);
+
+	SavePipe.Launch(UE_SOURCE_LOCATION, [WeakThis, Path = GetLeaderboardPath(), Count = TopRunCount]()
+	{
+		TArray<FRunResult> LoadedRuns = ReadTopRuns(Path, Count);
+
+		AsyncTask(ENamedThreads::GameThread, [WeakThis, LoadedRuns = MoveTemp(LoadedRuns)]() mutable
+		{
+			if (UCheeseChaseSaveSubsystem* This = WeakThis.Get())
+			{
+				This->FinishQuery(MoveTemp(LoadedRuns));
+			}
+		});
+	});
+}
+
+bool UCheeseChaseSaveSubsystem::IsHighScore(int32 Score, float Distance) const
+{
+	if (!bTopRunsLoaded) return false;
+
+	FRunResult Run;
+	Run.Score = Score;
+	Run.Distance = Distance;
+
+	return TopRuns.IsEmpty() || IsBetterRun(Run, TopRuns[0]);
+}
+
+int32 UCheeseChaseSaveSubsystem::InsertTopRun(const FRunResult& Result)
+{
+	int32 Index = 0;
+	while (Index < TopRuns.Num() && !IsBetterRun(Result, TopRuns[Index])) Index++;
+
+	if (Index >= TopRunCount) return INDEX_NONE;
+
+	TopRuns.Insert(Result, Index);
+	if (TopRuns.Num() > TopRunCount) TopRuns.SetNum(TopRunCount);
+
+	return Index;
+}
+
+void UCheeseChaseSaveSubsystem::FinishQuery(TArray<FRunResult>&& LoadedRuns)
+{
+	TopRuns = MoveTemp(LoadedRuns);
+
+	for (const FRunResult& Run : RunsSinceQuery)
+	{
+		InsertTopRun(Run);
+	}
+
+	bTopRunsLoaded = true;
+	OnTopRunsLoaded.Broadcast();
+}
+
+FString UCheeseChaseSaveSubsystem::GetLeaderboardPath()
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / TEXT("Leaderboard.bin");
+}
+
+void UCheeseChaseSaveSubsystem::AppendRecord(const FString& Path, const TArray<uint8>& Record)
+{
+	check(Record.Num() == LeaderboardRecordSize);
+
+	IFileManager& FileManager = IFileManager::Get();
+	int64 FileSize = FileManager.FileSize(*Path);
+
+	// Anything that isn't this version is moved aside rather than appended to
+	if (FileSize >= 0)
+	{
+		uint32 Magic = 0;
+		uint16 Version = 0;
+
+		if (TUniquePtr<FArchive> Reader = TUniquePtr<FArchive>(FileManager.CreateFileReader(*Path)); Reader && FileSize >= LeaderboardHeaderSize)
+		{
+			*Reader << Magic << Version;
+		}
+
+		if (Magic != LeaderboardMagic || Version != LeaderboardVersion)
+		{
+			UE_LOG(LogCheeseChase, Warning, TEXT("Leaderboard %s is version %d, starting a new one"), *Path, Version);
+			FileManager.Move(*FString::Printf(TEXT("%s.v%d"), *Path, Version), *Path);
+			FileSize = -1;
+		}
+	}
+
+	TUniquePtr<FArchive> Writer(FileManager.CreateFileWriter(*Path, FILEWRITE_Append));
+	if (!Writer)
+	{
+		UE_LOG(LogCheeseChase, Error, TEXT("Could not open leaderboard %s"), *Path);
+		return;
+	}
+
+	if (FileSize < 0)
+	{
+		uint32 Magic = LeaderboardMagic;
+		uint16 Version = LeaderboardVersion;
+		uint16 RecordSize = static_cast<uint16>(LeaderboardRecordSize);
+		*Writer << Magic << Version << RecordSize;
+	}
+	else if ((FileSize - LeaderboardHeaderSize) % LeaderboardRecordSize != 0)
+	{
+		// A torn write from a crash, pad it out so every following record stays aligned
+		TArray<uint8> Padding;
+		Padding.SetNumZeroed(static_cast<int32>(LeaderboardRecordSize - (FileSize - LeaderboardHeaderSize) % LeaderboardRecordSize));
+		Writer->Serialize(Padding.GetData(), Padding.Num());
+	}
+
+	Writer->Serialize(const_cast<uint8*>(Record.GetData()), Record.Num());
+}
+
+TArray<FRunResult> UCheeseChaseSaveSubsystem::ReadTopRuns(const FString& Path, int32 Count)
+{
+	TArray<FRunResult> Heap;
+
+	TUniquePtr<FArchive> Reader(IFileManager::Get().CreateFileReader(*Path));
+	if (!Reader || Reader->TotalSize() < LeaderboardHeaderSize) return Heap;
+
+	uint32 Magic = 0;
+	uint16 Version = 0;
+	uint16 RecordSize = 0;
+	*Reader << Magic << Version << RecordSize;
+
+	if (Magic != LeaderboardMagic || Version != LeaderboardVersion || RecordSize != LeaderboardRecordSize) return Heap;
+
+	// Worst of the kept runs sits on top of the heap, so memory stays at Count records whatever the file size
+	auto WorseRun = [](const FRunResult& A, const FRunResult& B) { return IsBetterRun(B, A); };
+
+	int64 RecordCount = (Reader->TotalSize() - LeaderboardHeaderSize) / LeaderboardRecordSize;
+	TArray<uint8> Chunk;
+
+	for (int64 First = 0; First < RecordCount; First += LeaderboardChunkRecords)
+	{
+		int64 ChunkCount = FMath::Min(LeaderboardChunkRecords, RecordCount - First);
+		Chunk.SetNumUninitialized(static_cast<int32>(ChunkCount * LeaderboardRecordSize));
+		Reader->Serialize(Chunk.GetData(), Chunk.Num());
+
+		FMemoryReader ChunkReader(Chunk);
+
+		for (int64 Index = 0; Index < ChunkCount; Index++)
+		{
+			FRunResult Run;
+			uint16 Checksum = 0;
+			ChunkReader << Run << Checksum;
+
+			// Torn writes, their padding and anything else that got mangled on disk
+			if (Checksum != GetRecordChecksum(Chunk.GetData() + Index * LeaderboardRecordSize)) continue;
+
+			if (Heap.Num() < Count)
+			{
+				Heap.HeapPush(Run, WorseRun);
+			}
+			else if (IsBetterRun(Run, Heap.HeapTop()))
+			{
+				Heap.HeapPopDiscard(WorseRun);
+				Heap.HeapPush(Run, WorseRun);
+			}
+		}
+	}
+
+	Heap.Sort(&IsBetterRun);
+	return Heap;
+}
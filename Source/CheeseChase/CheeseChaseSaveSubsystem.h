@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Tasks/Pipe.h"
+#include "CheeseChaseSaveSubsystem.generated.h"
+
+USTRUCT(BlueprintType)
+struct FRunResult
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 Seed = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 Score = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Distance = 0.0f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	float Duration = 0.0f;
+
+	// Tiles passed by shape
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 StraightTiles = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 LeftCornerTiles = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	int32 RightCornerTiles = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FDateTime Timestamp;
+
+	// Record fields, the leaderboard follows them with a checksum to make up LeaderboardRecordSize
+	friend FArchive& operator<<(FArchive& Ar, FRunResult& Result);
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnTopRunsLoaded);
+
+/**
+ * Run history and local leaderboard. Runs are appended as fixed size records to a versioned binary file on a
+ * background pipe, so saving at game over never touches the disk on the game thread. The leaderboard is read by
+ * streaming the file through a bounded heap, and the best runs are kept cached for the UI.
+ */
+UCLASS()
+class UCheeseChaseSaveSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	// Queues the run to be written, the cached leaderboard is updated immediately.
+	// Returns the place the run took in it, 0 for a new best, INDEX_NONE if it didn't make the top runs
+	// or the leaderboard hasn't loaded yet to place it against.
+	UFUNCTION(BlueprintCallable)
+	int32 SubmitRun(const FRunResult& Result);
+
+	// Re-reads the best Count runs from disk in the background, OnTopRunsLoaded fires when they are cached
+	UFUNCTION(BlueprintCallable)
+	void QueryTopRuns(int32 Count);
+
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE TArray<FRunResult> GetTopRuns() const { return TopRuns; }
+
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE bool AreTopRunsLoaded() const { return bTopRunsLoaded; }
+
+	// Whether a run would beat every cached one, ranked the way the leaderboard is. Only meaningful before the run is
+	// submitted, and false until the leaderboard has loaded.
+	UFUNCTION(BlueprintPure)
+	bool IsHighScore(int32 Score, float Distance) const;
+
+	UPROPERTY(BlueprintAssignable)
+	FOnTopRunsLoaded OnTopRunsLoaded;
+
+private:
+	int32 InsertTopRun(const FRunResult& Result);
+	void FinishQuery(TArray<FRunResult>&& LoadedRuns);
+
+	static FString GetLeaderboardPath();
+	static void AppendRecord(const FString& Path, const TArray<uint8>& Record);
+	static TArray<FRunResult> ReadTopRuns(const FString& Path, int32 Count);
+
+private:
+	// Every file access runs on this pipe, in the order it was queued
+	UE::Tasks::FPipe SavePipe{ TEXT("CheeseChaseSave") };
+
+	TArray<FRunResult> TopRuns;
+	int32 TopRunCount = 10;
+	bool bTopRunsLoaded = false;
+
+	// Runs queued after the pending query was read, merged back in when it lands
+	TArray<FRunResult> RunsSinceQuery;
+};
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ObstacleSolver.h"
+
+
+void FObstacleSolver::Reset()
+{
+	FMemory::Memzero(Blocked);
+	FMemory::Memzero(Reachable);
+
+	// Every run starts in the middle lane
+	SlotCount = 0;
+	Reachable[0] = 0b010;
+}
+
+int32 FObstacleSolver::Commit(float SlotLength, float SwitchDistance, TArrayView<uint8> BlockedLanes)
+{
+	// Never round a lane change down, if it outlasts the window the runner is assumed to be stuck in its lane
+	float SwitchSpan = SlotLength > KINDA_SMALL_NUMBER ? SwitchDistance / SlotLength : static_cast<float>(MaxWindow);
+	int32 SwitchSlots = SwitchSpan < MaxWindow ? FMath::Max(1, FMath::CeilToInt(SwitchSpan)) : INDEX_NONE;
+
+	int32 ClearedCount = 0;
+
+	for (uint8& SlotBlocked : BlockedLanes)
+	{
+		SlotBlocked &= AllLanes;
+
+		uint8 Previous = Reachable[SlotCount % MaxWindow];
+		uint8 Reach = static_cast<uint8>((Previous & ~SlotBlocked) | GetArrivals(SlotBlocked, SwitchSlots));
+
+		if (!Reach)
+		{
+			// Open the lowest lane the runner could have stayed in, previous slots always have one
+			uint8 Cleared = static_cast<uint8>(Previous & (~Previous + 1));
+			SlotBlocked &= ~Cleared;
+			Reach = static_cast<uint8>(Cleared | GetArrivals(SlotBlocked, SwitchSlots));
+			ClearedCount++;
+		}
+
+		SlotCount++;
+		Blocked[SlotCount % MaxWindow] = SlotBlocked;
+		Reachable[SlotCount % MaxWindow] = Reach;
+	}
+
+	return ClearedCount;
+}
+
+uint8 FObstacleSolver::GetArrivals(uint8 SlotBlocked, int32 SwitchSlots) const
+{
+	if (SwitchSlots == INDEX_NONE) return 0;
+
+	// The slot being added is SlotCount + 1, changes into it start SwitchSlots back
+	int32 SourceSlot = SlotCount + 1 - SwitchSlots;
+	if (SourceSlot < 0) return 0;
+
+	uint8 Between = 0;
+	for (int32 Slot = SourceSlot + 1; Slot <= SlotCount; Slot++)
+	{
+		Between |= Blocked[Slot % MaxWindow];
+	}
+
+	uint8 Source = Reachable[SourceSlot % MaxWindow];
+	uint8 Arrivals = 0;
+
+	for (int32 Lane = 0; Lane < 3; Lane++)
+	{
+		if (!(Source & (1 << Lane))) continue;
+
+		for (int32 Target : { Lane - 1, Lane + 1 })
+		{
+			if (Target < 0 || Target > 2) continue;
+
+			uint8 Lanes = static_cast<uint8>((1 << Lane) | (1 << Target));
+			if (!(Between & Lanes) && !(SlotBlocked & (1 << Target))) Arrivals |= 1 << Target;
+		}
+	}
+
+	return Arrivals;
+}
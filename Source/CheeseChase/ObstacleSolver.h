@@ -0,0 +1,35 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Keeps generated obstacles passable. The track is a lane x distance slot graph, each slot holding a mask of
+ * blocked lanes. Reachable lanes are carried forward slot by slot, a lane change taking however many slots its
+ * switch distance covers with both lanes clear in between. Any slot that would leave no lane reachable
+ * has an obstacle cleared, so every committed layout has a way through.
+ */
+class CHEESECHASE_API FObstacleSolver
+{
+public:
+	void Reset();
+
+	// Appends a tile's slots in running order, repairing them in place. Returns how many obstacles were cleared.
+	int32 Commit(float SlotLength, float SwitchDistance, TArrayView<uint8> BlockedLanes);
+
+	FORCEINLINE uint8 GetReachableLanes() const { return Reachable[SlotCount % MaxWindow]; }
+
+	static constexpr uint8 AllLanes = 0b111;
+
+private:
+	uint8 GetArrivals(uint8 Blocked, int32 SwitchSlots) const;
+
+private:
+	// Slots of history kept, a lane change spanning this many slots or more is treated as impossible
+	static constexpr int32 MaxWindow = 32;
+
+	uint8 Blocked[MaxWindow] = {};
+	uint8 Reachable[MaxWindow] = {};
+	int32 SlotCount = 0;
+};
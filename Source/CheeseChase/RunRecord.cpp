@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunRecord.h"
+
+#include "Misc/FileHelper.h"
+
+
+const TCHAR* FRunRecord::FileExtension = TEXT(".ccrun");
+
+static const TCHAR* RunRecordHeader = TEXT("CheeseChaseRun 2");
+
+bool FRunRecord::SaveToFile(const FString& Filename) const
+{
+	TArray<FString> Lines;
+	Lines.Reserve(Inputs.Num() + 7);
+
+	Lines.Add(RunRecordHeader);
+	Lines.Add(FString::Printf(TEXT("Seed %d"), Seed));
+	Lines.Add(FString::Printf(TEXT("Config %08x"), ConfigHash));
+	Lines.Add(FString::Printf(TEXT("Start %.4f %.2f"), StartTime, StartDistance));
+	Lines.Add(FString::Printf(TEXT("Duration %.4f"), Duration));
+	Lines.Add(FString::Printf(TEXT("Distance %.2f"), Distance));
+	Lines.Add(FString::Printf(TEXT("Score %d"), Score));
+
+	for (const FRunInput& Input : Inputs)
+	{
+		const TCHAR* TypeName = Input.Type == ERunInputType::Jump ? TEXT("Jump") : TEXT("Lane");
+		Lines.Add(FString::Printf(TEXT("Input %.4f %s %d"), Input.Time, TypeName, Input.Value));
+	}
+
+	return FFileHelper::SaveStringArrayToFile(Lines, *Filename);
+}
+
+bool FRunRecord::LoadFromFile(const FString& Filename)
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *Filename)) return false;
+	if (Lines.IsEmpty() || Lines[0] != RunRecordHeader) return false;
+
+	Inputs.Reset();
+	TArray<FString> Tokens;
+
+	for (int32 LineIndex = 1; LineIndex < Lines.Num(); LineIndex++)
+	{
+		Lines[LineIndex].ParseIntoArrayWS(Tokens);
+		if (Tokens.Num() < 2) continue;
+
+		const FString& Key = Tokens[0];
+
+		if (Key == TEXT("Seed")) Seed = FCString::Atoi(*Tokens[1]);
+		else if (Key == TEXT("Config")) ConfigHash = static_cast<uint32>(FCString::Strtoui64(*Tokens[1], nullptr, 16));
+		else if (Key == TEXT("Start") && Tokens.Num() == 3)
+		{
+			StartTime = FCString::Atof(*Tokens[1]);
+			StartDistance = FCString::Atof(*Tokens[2]);
+		}
+		else if (Key == TEXT("Duration")) Duration = FCString::Atof(*Tokens[1]);
+		else if (Key == TEXT("Distance")) Distance = FCString::Atof(*Tokens[1]);
+		else if (Key == TEXT("Score")) Score = FCString::Atoi(*Tokens[1]);
+		else if (Key == TEXT("Input") && Tokens.Num() == 4)
+		{
+			FRunInput& Input = Inputs.AddDefaulted_GetRef();
+			Input.Time = FCString::Atof(*Tokens[1]);
+			Input.Type = Tokens[2] == TEXT("Jump") ? ERunInputType::Jump : ERunInputType::ChooseLane;
+			Input.Value = static_cast<int8>(FCString::Atoi(*Tokens[3]));
+		}
+		else return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,44 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+enum class ERunInputType : uint8
+{
+	ChooseLane = 0,
+	Jump
+};
+
+struct FRunInput
+{
+	// Seconds since the run started
+	float Time = 0.0f;
+	ERunInputType Type = ERunInputType::ChooseLane;
+
+	// Lane direction for ChooseLane, unused for Jump
+	int8 Value = 0;
+};
+
+// A recorded run, enough to re-simulate it without the world. Score is the number of tiles passed.
+struct CHEESECHASE_API FRunRecord
+{
+	int32 Seed = 0;
+
+	// FRunVerifier::GetConfigHash of the game mode it was run with, runs only replay against the same config
+	uint32 ConfigHash = 0;
+
+	// When the runner first landed on a tile, and how far along the first tile's middle lane. Distance counts from there.
+	float StartTime = 0.0f;
+	float StartDistance = 0.0f;
+
+	float Duration = 0.0f;
+	float Distance = 0.0f;
+	int32 Score = 0;
+	TArray<FRunInput> Inputs;
+
+	bool SaveToFile(const FString& Filename) const;
+	bool LoadFromFile(const FString& Filename);
+
+	static const TCHAR* FileExtension;
+};
@@ -0,0 +1,216 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RunVerifier.h"
+
+#include "RunRecord.h"
+
+
+// Longer claims are rejected outright rather than simulated
+static constexpr float MaxRunDuration = 24.0f * 60.0f * 60.0f;
+
+// Distance error allowed on top of the relative tolerance, for settling onto the first lane and steering between lanes
+static constexpr float DistanceAllowance = 100.0f;
+
+// Slack for lane change rescaling, so changing into a lane level with an obstacle still hits it
+static constexpr float ObstacleTolerance = 1.0f;
+
+// The replay hits obstacles at their slot centre, the runner's capsule overlaps them a moment sooner or later
+static constexpr float ObstacleEndSlack = 0.5f;
+
+// Distance along the lane of the first obstacle in any of Lanes at or ahead of TileDistance, LaneLength if they are clear.
+// Slots sit at the same fractions of the lane as ATile::SetObstacles places them.
+static float GetObstacleDistance(TConstArrayView<uint8> Obstacles, uint8 Lanes, float TileDistance, float LaneLength)
+{
+	for (int32 Slot = 0; Slot < Obstacles.Num(); Slot++)
+	{
+		if (!(Obstacles[Slot] & Lanes)) continue;
+
+		float SlotDistance = (Slot + 0.5f) / Obstacles.Num() * LaneLength;
+		if (SlotDistance >= TileDistance - ObstacleTolerance) return FMath::Max(SlotDistance, TileDistance);
+	}
+
+	return LaneLength;
+}
+
+FRunVerifier::FRunVerifier(const FTrackGenerator& InTrackGenerator, float InRunSpeed, float InDistanceTolerance)
+	: TrackGenerator(InTrackGenerator)
+	, RunSpeed(InRunSpeed)
+	, DistanceTolerance(InDistanceTolerance)
+{
+	ConfigHash = GetConfigHash(TrackGenerator, RunSpeed);
+}
+
+uint32 FRunVerifier::GetConfigHash(const FTrackGenerator& TrackGenerator, float RunSpeed)
+{
+	return HashCombine(TrackGenerator.GetConfigHash(), GetTypeHash(FMath::RoundToInt32(RunSpeed)));
+}
+
+FRunVerification FRunVerifier::Verify(const FRunRecord& Run) const
+{
+	FRunVerification Result;
+
+	if (RunSpeed <= 0.0f)
+	{
+		Result.Error = TEXT("Runner has no speed");
+		return Result;
+	}
+	
+	if (Run.ConfigHash != ConfigHash)
+	{
+		Result.Error = FString::Printf(TEXT("Recorded with config %08x, verifying against %08x"), Run.ConfigHash, ConfigHash);
+		return Result;
+	}
+
+	if (Run.Duration < 0.0f || Run.Duration > MaxRunDuration)
+	{
+		Result.Error = FString::Printf(TEXT("Duration %.2fs is out of range"), Run.Duration);
+		return Result;
+	}
+
+	FTrackGenerator Generator = TrackGenerator;
+	Generator.Reseed(Run.Seed);
+
+	const FTrackTileInfo* Tile = Generator.Next();
+	if (!Tile)
+	{
+		Result.Error = TEXT("Track could not be generated");
+		return Result;
+	}
+
+	// The runner lands somewhere along the first tile after falling from the player start, the replay picks up from there
+	if (Run.StartTime < 0.0f || Run.StartTime > Run.Duration || Run.StartDistance < 0.0f || Run.StartDistance > Tile->GetLaneLength(ETileLane::Middle))
+	{
+		Result.Error = FString::Printf(TEXT("Start at %.4fs %.2f along the first tile is out of range"), Run.StartTime, Run.StartDistance);
+		return Result;
+	}
+
+	ETileLane Lane = ETileLane::Middle;
+	float TileDistance = Run.StartDistance;
+	double Distance = 0.0;
+	int32 TileIndex = 0;
+	float Time = Run.StartTime;
+	float InputTime = 0.0f;
+
+	// Obstacles end the run on overlap, once the replay reaches one Time stays where it happened
+	bool bHitObstacle = false;
+
+	// A lane change spends the tile's switch distance steering across, in reach of obstacles in every lane it crosses
+	uint8 SwitchLanes = 0;
+	float SwitchRemaining = 0.0f;
+
+	auto Advance = [&](float UntilTime)
+	{
+		while (Tile && !bHitObstacle)
+		{
+			float LaneLength = Tile->GetLaneLength(Lane);
+			if (LaneLength <= KINDA_SMALL_NUMBER) return false;
+
+			uint8 Lanes = SwitchRemaining > 0.0f ? SwitchLanes : static_cast<uint8>(1 << static_cast<uint8>(Lane));
+			float ObstacleDistance = GetObstacleDistance(Generator.GetObstacles(), Lanes, TileDistance, LaneLength);
+
+			// Step to the first of the next obstacle, the end of the tile or the end of the lane change
+			bool bSwitchEnds = SwitchRemaining > 0.0f && TileDistance + SwitchRemaining < ObstacleDistance;
+			float StepRemaining = bSwitchEnds ? SwitchRemaining : ObstacleDistance - TileDistance;
+			float Remaining = FMath::Max(UntilTime - Time, 0.0f) * RunSpeed;
+
+			if (Remaining < StepRemaining)
+			{
+				TileDistance += Remaining;
+				Distance += Remaining;
+				SwitchRemaining = FMath::Max(SwitchRemaining - Remaining, 0.0f);
+				Time = FMath::Max(Time, UntilTime);
+				return true;
+			}
+
+			TileDistance += StepRemaining;
+			Distance += StepRemaining;
+			SwitchRemaining = FMath::Max(SwitchRemaining - StepRemaining, 0.0f);
+			Time += StepRemaining / RunSpeed;
+
+			if (bSwitchEnds)
+			{
+				SwitchRemaining = 0.0f;
+				continue;
+			}
+
+			if (ObstacleDistance < LaneLength)
+			{
+				bHitObstacle = true;
+				break;
+			}
+
+			Tile = Generator.Next();
+			TileIndex++;
+			TileDistance = 0.0f;
+		}
+
+		return bHitObstacle;
+	};
+
+	for (const FRunInput& Input : Run.Inputs)
+	{
+		if (Input.Time < InputTime || Input.Time > Run.Duration)
+		{
+			Result.Error = FString::Printf(TEXT("Input at %.4fs is out of order"), Input.Time);
+			return Result;
+		}
+
+		InputTime = Input.Time;
+
+		// Inputs while still falling don't move the runner, only pick the lane it lands in
+		if (!Advance(Input.Time))
+		{
+			Result.Error = TEXT("Track could not be generated");
+			return Result;
+		}
+
+		if (bHitObstacle)
+		{
+			Result.Error = FString::Printf(TEXT("Input at %.4fs comes after the run ended at an obstacle at %.4fs"), Input.Time, Time);
+			return Result;
+		}
+
+		// Jumping doesn't change forward progress, only lane changes affect the path
+		if (Input.Type != ERunInputType::ChooseLane) continue;
+
+		int32 NewLaneIndex = static_cast<int32>(Lane) + Input.Value;
+		if (NewLaneIndex < 0 || NewLaneIndex > static_cast<int32>(ETileLane::Right)) continue;
+
+		ETileLane NewLane = static_cast<ETileLane>(NewLaneIndex);
+		TileDistance *= Tile->GetLaneLength(NewLane) / Tile->GetLaneLength(Lane);
+
+		// Changing again mid switch keeps every lane the runner is still crossing in play
+		SwitchLanes = (SwitchRemaining > 0.0f ? SwitchLanes : static_cast<uint8>(1 << static_cast<uint8>(Lane))) | static_cast<uint8>(1 << NewLaneIndex);
+		SwitchRemaining = Tile->LaneSwitchDistance;
+		Lane = NewLane;
+	}
+
+	if (!Advance(Run.Duration))
+	{
+		Result.Error = TEXT("Track could not be generated");
+		return Result;
+	}
+
+	if (bHitObstacle && Run.Duration > Time + ObstacleEndSlack)
+	{
+		Result.Error = FString::Printf(TEXT("Run claims %.2fs but ended at an obstacle after %.2fs"), Run.Duration, Time);
+		return Result;
+	}
+
+	Result.SimulatedDistance = Distance;
+	Result.SimulatedScore = TileIndex;
+
+	// Tile boxes hand the runner on around the end of each lane rather than exactly at it, so allow the score to be a tile either way
+	bool bDistanceMatches = FMath::Abs(Distance - Run.Distance) <= DistanceTolerance * Distance + DistanceAllowance;
+	bool bScoreMatches = FMath::Abs(TileIndex - Run.Score) <= 1;
+
+	Result.bVerified = bDistanceMatches && bScoreMatches;
+
+	if (!Result.bVerified)
+	{
+		Result.Error = FString::Printf(TEXT("Claimed %.0f distance and %d score, simulated %.0f and %d"), Run.Distance, Run.Score, Distance, TileIndex);
+	}
+
+	return Result;
+}
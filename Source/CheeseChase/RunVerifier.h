@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "TrackGenerator.h"
+
+struct FRunRecord;
+
+struct FRunVerification
+{
+	bool bVerified = false;
+	float SimulatedDistance = 0.0f;
+	int32 SimulatedScore = 0;
+	FString Error;
+};
+
+// Replays a recorded run against the seeded track without a world. The runner is modelled as
+// following its lane spline at a constant speed, keeping its progress through a tile when it changes lane.
+// Reaching an obstacle in its lane, or in either lane while it steers across, ends the run there as the obstacle's overlap does in game.
+class CHEESECHASE_API FRunVerifier
+{
+public:
+	FRunVerifier(const FTrackGenerator& InTrackGenerator, float InRunSpeed, float InDistanceTolerance);
+
+	// Safe to call from any number of threads at once
+	FRunVerification Verify(const FRunRecord& Run) const;
+
+	// Recorded with each run, covering the track layout and the runner speed the replay assumes
+	static uint32 GetConfigHash(const FTrackGenerator& TrackGenerator, float RunSpeed);
+
+private:
+	FTrackGenerator TrackGenerator;
+	float RunSpeed = 0.0f;
+	uint32 ConfigHash = 0;
+
+	// Allowed distance error relative to the simulated distance on top of a fixed allowance, physics movement never follows a lane exactly
+	float DistanceTolerance = 0.0f;
+};
@@ -0,0 +1,239 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#include "CheeseChaseCharacter.h"
+#include "CheeseChaseGameMode.h"
+#include "Tile.h"
+#include "TrackGenerator.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SplineComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/WorldSettings.h"
+#include "UObject/UnrealType.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace LaneFollowingTests
+{
+	static const TCHAR* GameModePath = TEXT("/Game/CheeseChase/Blueprints/BP_Game_GameMode.BP_Game_GameMode_C");
+
+	static constexpr double KilometreLength = 1000.0 * 100.0;
+	static constexpr int32 KilometreCount = 100;
+	static constexpr float DeltaSeconds = 1.0f / 30.0f;
+
+	// Left out of the error so the runner settling onto its lane after landing isn't taken for drift
+	static constexpr double SettleDistance = 1000.0;
+
+	// Worst error may wander this much between kilometres from where steps happen to land, lost precision shows up well past it
+	static constexpr double ErrorTolerance = 0.25;
+
+	// Acceleration after landing and steering onto the lane take a little off the ideal distance
+	static constexpr double DistanceTolerance = 0.01;
+
+	struct FLaneRun
+	{
+		double KilometreErrors[KilometreCount] = {};
+		double FarthestLocation = 0.0;
+		double Distance = 0.0;
+		double ExpectedDistance = 0.0;
+		float RebaseDistance = 0.0f;
+		int32 RebaseCount = 0;
+		bool bFinished = false;
+	};
+
+	// Game mode settings are private to the class and its blueprint, the test only turns off what would end or bend the run
+	template <typename PropertyType, typename ValueType>
+	static ValueType* FindGameModeValue(ACheeseChaseGameMode* GameMode, const TCHAR* PropertyName)
+	{
+		PropertyType* Property = FindFProperty<PropertyType>(GameMode->GetClass(), PropertyName);
+		return Property ? Property->template ContainerPtrToValuePtr<ValueType>(GameMode) : nullptr;
+	}
+
+	// Runs the default runner down the middle lane of a real track for 100 km, measuring how far off the lane it is
+	static FLaneRun RunLane(FAutomationTestBase& Test, UClass* GameModeClass, bool bRebase)
+	{
+		FLaneRun Run;
+
+		UGameInstance* GameInstance = NewObject<UGameInstance>(GEngine);
+		GameInstance->InitializeStandalone(TEXT("LaneFollowingTestWorld"));
+
+		UWorld* World = GameInstance->GetWorld();
+		World->GetWorldSettings()->DefaultGameMode = GameModeClass;
+		World->SetGameMode(FURL());
+		World->InitializeActorsForPlay(FURL());
+
+		ACheeseChaseGameMode* GameMode = Cast<ACheeseChaseGameMode>(World->GetAuthGameMode());
+		TMap<TSubclassOf<ATile>, ETileRarity>* TilePrefabs = GameMode ? FindGameModeValue<FMapProperty, TMap<TSubclassOf<ATile>, ETileRarity>>(GameMode, TEXT("TilePrefabs")) : nullptr;
+		float* ObstacleDensity = GameMode ? FindGameModeValue<FFloatProperty, float>(GameMode, TEXT("ObstacleDensity")) : nullptr;
+		float* RebaseDistance = GameMode ? FindGameModeValue<FFloatProperty, float>(GameMode, TEXT("RebaseDistance")) : nullptr;
+
+		if (!TilePrefabs || !ObstacleDensity || !RebaseDistance)
+		{
+			Test.AddError(TEXT("Could not set up the game mode"));
+			World->DestroyWorld(false);
+			GEngine->DestroyWorldContext(World);
+			return Run;
+		}
+
+		// Straights only, so the unrebased track heads as far from the origin as the run goes
+		for (auto Iterator = TilePrefabs->CreateIterator(); Iterator; ++Iterator)
+		{
+			if (!Iterator->Key || Iterator->Key->GetDefaultObject<ATile>()->IsCorner()) Iterator.RemoveCurrent();
+		}
+
+		*ObstacleDensity = 0.0f;
+		Run.RebaseDistance = *RebaseDistance;
+		if (!bRebase) *RebaseDistance = 0.0f;
+
+		// Spawned ahead of BeginPlay so the game mode sees a local player and doesn't try to create one without a viewport
+		APlayerController* PlayerController = World->SpawnActor<APlayerController>();
+		World->BeginPlay();
+
+		FTrackGenerator Generator = GameMode->CreateTrackGenerator(0);
+		const FTrackTileInfo* FirstTile = Generator.Next();
+		const ACheeseChaseCharacter* DefaultRunner = GameMode->DefaultPawnClass ? Cast<ACheeseChaseCharacter>(GameMode->DefaultPawnClass->GetDefaultObject()) : nullptr;
+
+		if (!FirstTile || !DefaultRunner)
+		{
+			Test.AddError(TEXT("Game mode has no starting tile or CheeseChase runner"));
+			World->DestroyWorld(false);
+			GEngine->DestroyWorldContext(World);
+			return Run;
+		}
+
+		// Dropped onto the middle of the first tile's middle lane, the way a player start above the track would
+		FVector SpawnLocation(FirstTile->FloorBounds.X, 0.0, 2.0 * FirstTile->FloorBounds.Z + DefaultRunner->GetCapsuleComponent()->GetScaledCapsuleHalfHeight() + 20.0);
+
+		FActorSpawnParameters SpawnParameters;
+		SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+		ACheeseChaseCharacter* Runner = World->SpawnActor<ACheeseChaseCharacter>(GameMode->DefaultPawnClass, FTransform(SpawnLocation), SpawnParameters);
+
+		if (!Runner)
+		{
+			Test.AddError(TEXT("Could not spawn the runner"));
+			World->DestroyWorld(false);
+			GEngine->DestroyWorldContext(World);
+			return Run;
+		}
+
+		PlayerController->Possess(Runner);
+
+		float RunSpeed = Runner->GetCharacterMovement()->MaxWalkSpeed;
+		float MaxRunTime = 1.5f * KilometreCount * KilometreLength / FMath::Max(RunSpeed, 1.0f);
+		float RunTime = 0.0f;
+
+		bool bHasLanded = false;
+		FVector LastLocation = Runner->GetActorLocation();
+
+		while (RunTime < MaxRunTime)
+		{
+			// Timers, Move among them, only tick once a frame
+			GFrameCounter++;
+			World->Tick(LEVELTICK_All, DeltaSeconds);
+			RunTime += DeltaSeconds;
+
+			ATile* Tile = Runner->GetCurrentTile();
+			FVector Location = Runner->GetActorLocation();
+
+			if (!Tile)
+			{
+				if (RunTime > 5.0f)
+				{
+					Test.AddError(TEXT("Runner never landed on the track"));
+					break;
+				}
+
+				continue;
+			}
+
+			if (GameMode->GetTile(Tile->GetTileIndex()) != Tile)
+			{
+				Test.AddError(FString::Printf(TEXT("Runner lost its tile %.1f km in"), Runner->GetRunRecord().Distance / KilometreLength));
+				break;
+			}
+
+			// The only way the runner moves further than a few steps in one frame is being shifted with the track
+			if (bHasLanded && FVector::Dist2D(Location, LastLocation) > 10.0 * RunSpeed * DeltaSeconds) Run.RebaseCount++;
+
+			bHasLanded = true;
+			LastLocation = Location;
+
+			FRunRecord Record = Runner->GetRunRecord();
+			Run.Distance = Record.Distance;
+			Run.ExpectedDistance = RunSpeed * (Record.Duration - Record.StartTime);
+			Run.FarthestLocation = FMath::Max(Run.FarthestLocation, Location.Size2D());
+
+			if (Record.Distance >= KilometreCount * KilometreLength)
+			{
+				Run.bFinished = true;
+				break;
+			}
+
+			if (Record.Distance < SettleDistance) continue;
+
+			// Sideways off the lane in world space, running past the end of a lane before the next tile box takes over isn't an error
+			USplineComponent* Spline = Tile->GetLaneSpline(Runner->GetMovementLane());
+			float InputKey = Spline->FindInputKeyClosestToWorldLocation(Location);
+			FVector LaneLocation = Spline->GetLocationAtSplineInputKey(InputKey, ESplineCoordinateSpace::World);
+			FVector LaneRight = Spline->GetRightVectorAtSplineInputKey(InputKey, ESplineCoordinateSpace::World);
+
+			double& KilometreError = Run.KilometreErrors[FMath::Min(static_cast<int32>(Record.Distance / KilometreLength), KilometreCount - 1)];
+			KilometreError = FMath::Max(KilometreError, FMath::Abs(FVector::DotProduct(Location - LaneLocation, LaneRight)));
+		}
+
+		World->DestroyWorld(false);
+		GEngine->DestroyWorldContext(World);
+
+		return Run;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FLaneFollowingPrecisionTest, "CheeseChase.Track.LaneFollowingPrecision", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::StressFilter)
+
+bool FLaneFollowingPrecisionTest::RunTest(const FString& Parameters)
+{
+	using namespace LaneFollowingTests;
+
+	UClass* GameModeClass = LoadClass<ACheeseChaseGameMode>(nullptr, GameModePath);
+	if (!GameModeClass)
+	{
+		AddError(FString::Printf(TEXT("Could not load game mode %s"), GameModePath));
+		return false;
+	}
+
+	FLaneRun Runs[2] = { RunLane(*this, GameModeClass, false), RunLane(*this, GameModeClass, true) };
+
+	for (int32 Index = 0; Index < 2; Index++)
+	{
+		const FLaneRun& Run = Runs[Index];
+		const TCHAR* RunName = Index ? TEXT("Rebased") : TEXT("Unrebased");
+
+		if (!Run.bFinished)
+		{
+			AddError(FString::Printf(TEXT("%s run stopped after %.1f km"), RunName, Run.Distance / KilometreLength));
+			continue;
+		}
+
+		double WorstError = 0.0;
+		for (double KilometreError : Run.KilometreErrors) WorstError = FMath::Max(WorstError, KilometreError);
+
+		AddInfo(FString::Printf(TEXT("%s: %.4f cm worst error in the first km, %.4f cm in the last, %.4f cm overall, %.1f km from the origin at most, %d rebases"),
+			RunName, Run.KilometreErrors[0], Run.KilometreErrors[KilometreCount - 1], WorstError, Run.FarthestLocation / KilometreLength, Run.RebaseCount));
+
+		TestTrue(FString::Printf(TEXT("%s lane following error holds over 100 km"), RunName), WorstError <= Run.KilometreErrors[0] + ErrorTolerance);
+		TestTrue(FString::Printf(TEXT("%s distance %.0f matches running time at full speed %.0f"), RunName, Run.Distance, Run.ExpectedDistance), FMath::Abs(Run.Distance - Run.ExpectedDistance) <= DistanceTolerance * Run.ExpectedDistance);
+	}
+
+	TestTrue(TEXT("Unrebased run leaves the origin far behind"), Runs[0].FarthestLocation > 10.0 * Runs[0].RebaseDistance);
+	TestTrue(TEXT("Rebased run stays near the origin"), Runs[1].RebaseCount > 0 && Runs[1].FarthestLocation < 2.0 * Runs[1].RebaseDistance);
+
+	return true;
+}
+
+#endif
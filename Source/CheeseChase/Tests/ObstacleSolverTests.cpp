@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+
+#include "ObstacleSolver.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace ObstacleSolverTests
+{
+	// FObstacleSolver treats lane changes spanning its history window or more as impossible
+	static constexpr int32 SolverWindow = 32;
+
+	// Per tile budget the solver has to fit in, it runs on the game thread for every generated tile
+	static constexpr double TileBudgetMicroseconds = 50.0;
+
+	static constexpr int32 SeedCount = 2000;
+	static constexpr int32 TilesPerSeed = 1000;
+
+	static int32 GetSwitchSlots(float SwitchDistance, float SlotLength)
+	{
+		float SwitchSpan = SwitchDistance / SlotLength;
+		return SwitchSpan < SolverWindow ? FMath::Max(1, FMath::CeilToInt32(SwitchSpan)) : INDEX_NONE;
+	}
+
+	// Lanes reachable at the slot after the last one in Reach, found by trying every stay and lane change into it
+	// against the whole history rather than the solver's ring
+	static uint8 GetReach(const TArray<uint8>& Blocked, const TArray<uint8>& Reach, uint8 SlotBlocked, int32 SwitchSlots)
+	{
+		int32 Slot = Reach.Num();
+		uint8 Result = static_cast<uint8>(Reach.Last() & ~SlotBlocked);
+
+		if (SwitchSlots == INDEX_NONE || Slot - SwitchSlots < 0) return Result;
+
+		for (int32 Lane = 0; Lane < 3; Lane++)
+		{
+			if (!(Reach[Slot - SwitchSlots] & (1 << Lane))) continue;
+
+			for (int32 Target = 0; Target < 3; Target++)
+			{
+				if (FMath::Abs(Target - Lane) != 1 || (SlotBlocked & (1 << Target))) continue;
+
+				bool bIsClear = true;
+				for (int32 Between = Slot - SwitchSlots + 1; Between < Slot && bIsClear; Between++)
+				{
+					bIsClear = !(Blocked[Between] & ((1 << Lane) | (1 << Target)));
+				}
+
+				if (bIsClear) Result |= 1 << Target;
+			}
+		}
+
+		return Result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FObstacleSolverFuzzTest, "CheeseChase.ObstacleSolver.Fuzz", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FObstacleSolverFuzzTest::RunTest(const FString& Parameters)
+{
+	using namespace ObstacleSolverTests;
+
+	FObstacleSolver Solver;
+	TArray<uint8> Layout;
+	TArray<uint8> Blocked;
+	TArray<uint8> Reach;
+
+	uint64 TotalCycles = 0;
+	uint64 MaxCycles = 0;
+	int64 TileCount = 0;
+	int64 ClearedCount = 0;
+
+	for (int32 Seed = 0; Seed < SeedCount; Seed++)
+	{
+		FRandomStream Stream(Seed);
+
+		// Wide enough that some seeds can't change lane within the solver's window at all
+		float SwitchDistance = Stream.FRandRange(15.0f, 1500.0f);
+		float Density = Stream.FRandRange(0.0f, 0.8f);
+
+		Solver.Reset();
+
+		Blocked.Reset();
+		Reach.Reset();
+		Blocked.Add(0);
+		Reach.Add(0b010);
+
+		for (int32 Tile = 0; Tile < TilesPerSeed; Tile++)
+		{
+			Layout.SetNumUninitialized(Stream.RandRange(1, 8));
+			for (uint8& SlotBlocked : Layout)
+			{
+				// Stray high bits must be ignored
+				SlotBlocked = static_cast<uint8>(Stream.RandHelper(256));
+				for (int32 Lane = 0; Lane < 3; Lane++)
+				{
+					if (Stream.FRand() >= Density) SlotBlocked &= ~(1 << Lane);
+				}
+			}
+
+			TArray<uint8, TInlineAllocator<8>> Original(Layout);
+			float SlotLength = Stream.FRandRange(200.0f, 3000.0f) / Layout.Num();
+
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			ClearedCount += Solver.Commit(SlotLength, SwitchDistance, Layout);
+			uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+			TotalCycles += Cycles;
+			MaxCycles = FMath::Max(MaxCycles, Cycles);
+			TileCount++;
+
+			int32 SwitchSlots = GetSwitchSlots(SwitchDistance, SlotLength);
+
+			for (int32 Slot = 0; Slot < Layout.Num(); Slot++)
+			{
+				uint8 Requested = Original[Slot] & FObstacleSolver::AllLanes;
+				uint8 Cleared = Requested & ~Layout[Slot];
+
+				if (Layout[Slot] & ~Requested)
+				{
+					AddError(FString::Printf(TEXT("Seed %d tile %d slot %d: solver added obstacles 0x%x to 0x%x"), Seed, Tile, Slot, Layout[Slot], Requested));
+					return false;
+				}
+
+				// Repairs only happen where the requested slot is a dead end, and take out a single obstacle
+				bool bIsDeadEnd = GetReach(Blocked, Reach, Requested, SwitchSlots) == 0;
+				if (bIsDeadEnd != (Cleared != 0) || FMath::CountBits(Cleared) > 1)
+				{
+					AddError(FString::Printf(TEXT("Seed %d tile %d slot %d: cleared 0x%x from 0x%x, dead end %d"), Seed, Tile, Slot, Cleared, Requested, bIsDeadEnd));
+					return false;
+				}
+
+				uint8 SlotReach = GetReach(Blocked, Reach, Layout[Slot], SwitchSlots);
+				if (!SlotReach)
+				{
+					AddError(FString::Printf(TEXT("Seed %d tile %d slot %d: repaired layout 0x%x has no way through"), Seed, Tile, Slot, Layout[Slot]));
+					return false;
+				}
+
+				Blocked.Add(Layout[Slot]);
+				Reach.Add(SlotReach);
+			}
+
+			if (Solver.GetReachableLanes() != Reach.Last())
+			{
+				AddError(FString::Printf(TEXT("Seed %d tile %d: solver reaches 0x%x, reference 0x%x"), Seed, Tile, Solver.GetReachableLanes(), Reach.Last()));
+				return false;
+			}
+		}
+	}
+
+	double AverageMicroseconds = FPlatformTime::ToMilliseconds64(TotalCycles) * 1000.0 / TileCount;
+	double MaxMicroseconds = FPlatformTime::ToMilliseconds64(MaxCycles) * 1000.0;
+
+	AddInfo(FString::Printf(TEXT("%lld tiles, %lld obstacles cleared, %.3f us average, %.3f us worst per tile"), TileCount, ClearedCount, AverageMicroseconds, MaxMicroseconds));
+
+	// The worst case is reported rather than asserted, a single preempted tile says nothing about the solver
+	TestTrue(FString::Printf(TEXT("Average tile cost %.3f us within %.0f us budget"), AverageMicroseconds, TileBudgetMicroseconds), AverageMicroseconds < TileBudgetMicroseconds);
+
+	return true;
+}
+
+#endif
@@ -38,7 +38,7 @@ ATile::ATile()
 
 	RightLaneSpline = CreateDefaultSubobject<USplineComponent>(TEXT("RightLane"));
 	RightLaneSpline->SetupAttachment(FloorMesh);
-	
+
 	FrontWallMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("FrontWallMesh"));
 	FrontWallMesh->SetupAttachment(FloorMesh);
 
@@ -80,7 +80,23 @@ void ATile::BeginPlay()
 	}
 	
 	TileBox->OnComponentBeginOverlap.AddDynamic(this, &ATile::TileBoxBeginOverlap);
-	TileBox->OnComponentEndOverlap.AddDynamic(this, &ATile::TileBoxEndOverlap);
+}
+
+void ATile::Activate(const FTransform& Transform)
+{
+	SetActorTransform(Transform, false, nullptr, ETeleportType::TeleportPhysics);
+	SetActorHiddenInGame(false);
+	SetActorEnableCollision(true);
+}
+
+void ATile::Deactivate()
+{
+	SetActorHiddenInGame(true);
+	SetActorEnableCollision(false);
+	TileIndex = INDEX_NONE;
+
+	// Attached actors don't inherit hidden or collision state
+	SetObstacles({});
 }
 
 FTransform ATile::GetNextAttachTransform() const
@@ -110,21 +126,152 @@ class USplineComponent* ATile::GetLaneSpline(ETileLane TileLane)
 	return Spline;
 }
 
-void ATile::TileBoxBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
+void ATile::SetObstacles(TConstArrayView<uint8> BlockedLanes)
 {
-	if (ACheeseChaseCharacter* Player = Cast<ACheeseChaseCharacter>(OtherActor))
+	int32 ObstacleCount = 0;
+	UWorld* World = GetWorld();
+
+	for (int32 Slot = 0; Slot < BlockedLanes.Num() && ObstacleClass && World; Slot++)
 	{
-		Player->SetCurrentTile(this);
+		for (ETileLane TileLane : { ETileLane::Left, ETileLane::Middle, ETileLane::Right })
+		{
+			if (!(BlockedLanes[Slot] & (1 << static_cast<uint8>(TileLane)))) continue;
+
+			USplineComponent* LaneSpline = GetLaneSpline(TileLane);
+			float Distance = (Slot + 0.5f) / BlockedLanes.Num() * LaneSpline->GetSplineLength();
+			FTransform ObstacleTransform = LaneSpline->GetTransformAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+
+			if (ObstacleCount == Obstacles.Num())
+			{
+				FActorSpawnParameters SpawnParameters;
+				SpawnParameters.Owner = this;
+				SpawnParameters.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+				AActor* Obstacle = World->SpawnActor<AActor>(ObstacleClass, ObstacleTransform, SpawnParameters);
+				if (!Obstacle) continue;
+
+				Obstacle->AttachToComponent(FloorMesh, FAttachmentTransformRules::KeepWorldTransform);
+				Obstacles.Add(Obstacle);
+			}
+
+			AActor* Obstacle = Obstacles[ObstacleCount++];
+			Obstacle->SetActorTransform(ObstacleTransform, false, nullptr, ETeleportType::TeleportPhysics);
+			Obstacle->SetActorHiddenInGame(false);
+			Obstacle->SetActorEnableCollision(true);
+		}
+	}
+
+	for (int32 Index = ObstacleCount; Index < Obstacles.Num(); Index++)
+	{
+		if (!Obstacles[Index]) continue;
+
+		Obstacles[Index]->SetActorHiddenInGame(true);
+		Obstacles[Index]->SetActorEnableCollision(false);
+	}
+}
+
+FVector ATile::GetFloorBounds() const
+{
+	return FloorMeshAsset ? FVector(FloorMeshAsset->GetBounds().BoxExtent) : FVector::ZeroVector;
+}
+
+void ATile::GetLaneKeys(const FVector& FloorBounds, ETileAttachLocation AttachLocation, float LaneSpacing, ETileLane TileLane, FVector& OutBegin, FVector& OutEnd, FVector& OutBeginLeaveTangent, FVector& OutEndArriveTangent)
+{
+	// Left lane sits at -1, middle at 0 and right at 1 lane offsets
+	float LaneY = (static_cast<float>(TileLane) - 1.0f) * GetLaneSpacing(FloorBounds, LaneSpacing);
+	float ZBuffer = FloorBounds.Z+10.0f;
+
+	float Overhang = 0.0f;
+
+	OutBegin = FVector(-FloorBounds.X - Overhang, LaneY, ZBuffer);
+	OutBeginLeaveTangent = FVector::ZeroVector;
+	OutEndArriveTangent = FVector::ZeroVector;
+
+	switch (AttachLocation)
+	{
+	case ETileAttachLocation::Left:
+		OutEnd = FVector(LaneY, -FloorBounds.Y - Overhang, ZBuffer);
+		break;
+		
+	case ETileAttachLocation::Right:
+		OutEnd = FVector(-LaneY, FloorBounds.Y + Overhang, ZBuffer);
+		break;
+		
+	default:
+		OutEnd = FVector(FloorBounds.X + Overhang, LaneY, ZBuffer);
+		return;
+	}
+
+	OutBeginLeaveTangent = FVector((OutEnd.X - OutBegin.X) * 2.5, 0.0f, 0.0f);
+	OutEndArriveTangent = FVector(0.0f, (OutEnd.Y - OutBegin.Y) * 2.5, 0.0f);
+}
+
+FTransform ATile::GetNextAttachKey(const FVector& FloorBounds, ETileAttachLocation AttachLocation)
+{
+	FVector TargetLocation = FVector::ZeroVector;
+	FRotator TargetRotation = FRotator::ZeroRotator;
+
+	switch (AttachLocation)
+	{
+	case ETileAttachLocation::Forward:
+		TargetLocation.X = FloorBounds.X;
+		TargetRotation.Yaw = 0.0f;
+		break;
+	case ETileAttachLocation::Left:
+		TargetLocation.Y = -FloorBounds.Y;
+		TargetRotation.Yaw = -90.0f;
+		break;
+	case ETileAttachLocation::Right:
+		TargetLocation.Y = FloorBounds.Y;
+		TargetRotation.Yaw = 90.0f;
+		break;
+	default:
+		break;
 	}
+
+	return FTransform(TargetRotation, TargetLocation);
+}
+
+float ATile::GetLaneSpacing(const FVector& FloorBounds, float LaneSpacing)
+{
+	return FloorBounds.Y/2*LaneSpacing;
 }
 
-void ATile::TileBoxEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex)
+float ATile::GetLaneLength(const FVector& FloorBounds, ETileAttachLocation AttachLocation, float LaneSpacing, ETileLane TileLane)
+{
+	FVector Begin, End, BeginLeaveTangent, EndArriveTangent;
+	GetLaneKeys(FloorBounds, AttachLocation, LaneSpacing, TileLane, Begin, End, BeginLeaveTangent, EndArriveTangent);
+
+	if (AttachLocation == ETileAttachLocation::Forward) return FVector::Dist(Begin, End);
+
+	// Walk the same hermite segment the spline component builds for a corner
+	constexpr int32 Steps = 64;
+	float Length = 0.0f;
+	FVector Previous = Begin;
+
+	for (int32 Step = 1; Step <= Steps; Step++)
+	{
+		FVector Point = FMath::CubicInterp(Begin, BeginLeaveTangent, End, EndArriveTangent, static_cast<float>(Step) / Steps);
+		Length += FVector::Dist(Previous, Point);
+		Previous = Point;
+	}
+
+	return Length;
+}
+
+void ATile::TileBoxBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult& SweepResult)
 {
 	if (ACheeseChaseCharacter* Player = Cast<ACheeseChaseCharacter>(OtherActor))
 	{
+		// Tile boxes overlap at the seams, only ever move a player forward along the chain
+		ATile* PlayerTile = Player->GetCurrentTile();
+		if (PlayerTile && PlayerTile->GetTileIndex() >= TileIndex) return;
+		
+		Player->SetCurrentTile(this);
+
 		if (GameMode)
 		{
-			GameMode->SpawnTiles(1);
+			GameMode->UpdateTrack();
 		}
 	}
 }
@@ -199,147 +346,38 @@ void ATile::UpdateTileBox()
 
 void ATile::UpdateNextAttachArrow()
 {
-	FVector TargetLocation = FVector::ZeroVector;
-	FRotator TargetRotation = FRotator::ZeroRotator;
-	
-	if (FloorMeshAsset)
-	{
-		FVector FloorBounds = FloorMeshAsset->GetBounds().BoxExtent;
-
-		switch (E_NextAttachLocation)
-		{
-			case ETileAttachLocation::Forward:
-				TargetLocation.X = FloorBounds.X;
-				break;
-			case ETileAttachLocation::Left:
-				TargetLocation.Y = -FloorBounds.Y;
-				break;
-			case ETileAttachLocation::Right:
-				TargetLocation.Y = FloorBounds.Y;
-				break;
-		default:
-			break;
-		}
-	}
-	
-	switch (E_NextAttachLocation)
-	{
-	case ETileAttachLocation::Forward:
-		TargetRotation.Yaw = 0.0f;
-		break;
-	case ETileAttachLocation::Left:
-		TargetRotation.Yaw = -90.0f;
-		break;
-	case ETileAttachLocation::Right:
-		TargetRotation.Yaw = 90.0f;
-		break;
-	default:
-		break;
-	}
+	FTransform AttachTransform = GetNextAttachKey(GetFloorBounds(), E_NextAttachLocation);
 
-	NextAttachArrow->SetRelativeLocation(TargetLocation);
-	NextAttachArrow->SetRelativeRotation(TargetRotation);
+	NextAttachArrow->SetRelativeLocation(AttachTransform.GetLocation());
+	NextAttachArrow->SetRelativeRotation(AttachTransform.GetRotation());
 }
 
 void ATile::UpdateLanes()
 {
-	LeftLaneSpline->ClearSplinePoints();
-	MiddleLaneSpline->ClearSplinePoints();
-	RightLaneSpline->ClearSplinePoints();
+	FVector FloorBounds = GetFloorBounds();
 	
-	FVector LeftLaneBegin = FVector::ZeroVector;
-	FVector MiddleLaneBegin = FVector::ZeroVector;
-	FVector RightLaneBegin = FVector::ZeroVector;
-
-	FVector LeftLaneEnd = FVector::ZeroVector;
-	FVector MiddleLaneEnd = FVector::ZeroVector;
-	FVector RightLaneEnd = FVector::ZeroVector;
-
-	FVector LeftLaneBeginLeaveTangent = FVector::ZeroVector;
-	FVector LeftLaneEndArriveTangent = FVector::ZeroVector;
-	FVector MiddleLaneBeginLeaveTangent = FVector::ZeroVector;
-	FVector MiddleLaneEndArriveTangent = FVector::ZeroVector;
-	FVector RightLaneBeginLeaveTangent = FVector::ZeroVector;
-	FVector RightLaneEndArriveTangent = FVector::ZeroVector;
-	
-	if (FloorMeshAsset)
+	for (ETileLane TileLane : { ETileLane::Left, ETileLane::Middle, ETileLane::Right })
 	{
-		FVector FloorBounds = FloorMeshAsset->GetBounds().BoxExtent;
-
-		float LeftLaneY = -FloorBounds.Y/2*LaneSpacingMultiplier;
-		float RightLaneY = FloorBounds.Y/2*LaneSpacingMultiplier;
-		float ZBuffer = FloorBounds.Z+10.0f;
+		USplineComponent* LaneSpline = GetLaneSpline(TileLane);
+		LaneSpline->ClearSplinePoints();
 
-		float Overhang = 0.0f;
-		
-		LeftLaneBegin = FVector(-FloorBounds.X - Overhang, LeftLaneY, ZBuffer);
-		MiddleLaneBegin = FVector(-FloorBounds.X - Overhang, 0.0f, ZBuffer);
-		RightLaneBegin = FVector(-FloorBounds.X - Overhang, RightLaneY, ZBuffer);
+		FVector LaneBegin = FVector::ZeroVector;
+		FVector LaneEnd = FVector::ZeroVector;
+		FVector LaneBeginLeaveTangent = FVector::ZeroVector;
+		FVector LaneEndArriveTangent = FVector::ZeroVector;
 
-		if (E_NextAttachLocation != ETileAttachLocation::Forward)
+		if (FloorMeshAsset)
 		{
-			float LeftLaneTurnX = 0.0f;
-			float RightLaneTurnX = 0.0f;
-			float LaneEndY = 0.0f;
-
-			switch (E_NextAttachLocation)
-			{
-			case ETileAttachLocation::Left:
-				LeftLaneTurnX = -FloorBounds.Y/2*LaneSpacingMultiplier;
-				RightLaneTurnX = FloorBounds.Y/2*LaneSpacingMultiplier;
-				LaneEndY = -FloorBounds.Y - Overhang;
-				break;
-				
-			case ETileAttachLocation::Right:
-				LeftLaneTurnX = FloorBounds.Y/2*LaneSpacingMultiplier;
-				RightLaneTurnX = -FloorBounds.Y/2*LaneSpacingMultiplier;
-				LaneEndY = FloorBounds.Y + Overhang;
-				break;
-				
-			default:
-				break;
-			}
-			
-			LeftLaneEnd = FVector(LeftLaneTurnX, LaneEndY, ZBuffer);
-			MiddleLaneEnd = FVector(0.0f, LaneEndY, ZBuffer);
-			RightLaneEnd = FVector(RightLaneTurnX, LaneEndY, ZBuffer);
-
-			LeftLaneBeginLeaveTangent = FVector((LeftLaneEnd.X - LeftLaneBegin.X) * 2.5, 0.0f, 0.0f);
-			LeftLaneEndArriveTangent = FVector(0.0f, (LeftLaneEnd.Y - LeftLaneBegin.Y) * 2.5, 0.0f);
-
-			MiddleLaneBeginLeaveTangent = FVector((MiddleLaneEnd.X - MiddleLaneBegin.X) * 2.5, 0.0f, 0.0f);
-			MiddleLaneEndArriveTangent = FVector(0.0f, (MiddleLaneEnd.Y - MiddleLaneBegin.Y) * 2.5, 0.0f);
-
-			RightLaneBeginLeaveTangent = FVector((RightLaneEnd.X - RightLaneBegin.X) * 2.5, 0.0f, 0.0f);
-			RightLaneEndArriveTangent = FVector(0.0f, (RightLaneEnd.Y - RightLaneBegin.Y) * 2.5, 0.0f);
-
-			goto PopulateSplines;
+			GetLaneKeys(FloorBounds, E_NextAttachLocation, LaneSpacingMultiplier, TileLane, LaneBegin, LaneEnd, LaneBeginLeaveTangent, LaneEndArriveTangent);
 		}
 
-		LeftLaneEnd = FVector(FloorBounds.X + Overhang, LeftLaneY, ZBuffer);
-		MiddleLaneEnd = FVector(FloorBounds.X + Overhang, 0.0f, ZBuffer);
-		RightLaneEnd = FVector(FloorBounds.X + Overhang, RightLaneY, ZBuffer);
-	}
+		LaneSpline->AddSplineLocalPoint(LaneBegin);
+		LaneSpline->AddSplineLocalPoint(LaneEnd);
 
-	PopulateSplines:
-	
-	LeftLaneSpline->AddSplineLocalPoint(LeftLaneBegin);
-	MiddleLaneSpline->AddSplineLocalPoint(MiddleLaneBegin);
-	RightLaneSpline->AddSplineLocalPoint(RightLaneBegin);
-
-	LeftLaneSpline->AddSplineLocalPoint(LeftLaneEnd);
-	MiddleLaneSpline->AddSplineLocalPoint(MiddleLaneEnd);
-	RightLaneSpline->AddSplineLocalPoint(RightLaneEnd);
-	
-	if (E_NextAttachLocation != ETileAttachLocation::Forward)
-	{
-		LeftLaneSpline->SetTangentsAtSplinePoint(0, FVector(0.0f, 0.0f, 0.0f), LeftLaneBeginLeaveTangent, ESplineCoordinateSpace::Local);
-		LeftLaneSpline->SetTangentsAtSplinePoint(1, LeftLaneEndArriveTangent, FVector(0.0f, 0.0f,0.0f), ESplineCoordinateSpace::Local);
-
-		MiddleLaneSpline->SetTangentsAtSplinePoint(0, FVector(0.0f, 0.0f, 0.0f), MiddleLaneBeginLeaveTangent, ESplineCoordinateSpace::Local);
-		MiddleLaneSpline->SetTangentsAtSplinePoint(1, MiddleLaneEndArriveTangent, FVector(0.0f, 0.0f,0.0f), ESplineCoordinateSpace::Local);
-
-		RightLaneSpline->SetTangentsAtSplinePoint(0, FVector(0.0f, 0.0f, 0.0f), RightLaneBeginLeaveTangent, ESplineCoordinateSpace::Local);
-		RightLaneSpline->SetTangentsAtSplinePoint(1, RightLaneEndArriveTangent, FVector(0.0f, 0.0f,0.0f), ESplineCoordinateSpace::Local);
+		if (IsCorner())
+		{
+			LaneSpline->SetTangentsAtSplinePoint(0, FVector(0.0f, 0.0f, 0.0f), LaneBeginLeaveTangent, ESplineCoordinateSpace::Local);
+			LaneSpline->SetTangentsAtSplinePoint(1, LaneEndArriveTangent, FVector(0.0f, 0.0f,0.0f), ESplineCoordinateSpace::Local);
+		}
 	}
 }
@@ -85,6 +85,10 @@ class CHEESECHASE_API ATile : public AActor
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Appearance", meta = (AllowPrivateAccess = "true"))
 	class UStaticMesh* RightWallMeshAsset = nullptr;
 
+	// Placed in each blocked lane, BP_Obstacle ends the run when a runner overlaps it
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Obstacles", meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<AActor> ObstacleClass;
+
 public:
 	// Sets default values for this actor's properties
 	ATile();
@@ -101,14 +105,38 @@ public:
 	UFUNCTION(BlueprintPure)
 	class USplineComponent* GetLaneSpline(ETileLane TileLane);
 
+	FVector GetFloorBounds() const;
+
+	FORCEINLINE ETileAttachLocation GetNextAttachLocation() const { return E_NextAttachLocation; }
+	FORCEINLINE float GetLaneSpacingMultiplier() const { return LaneSpacingMultiplier; }
+	FORCEINLINE int32 GetObstacleSlots() const { return ObstacleSlots; }
+	FORCEINLINE bool HasObstacles() const { return ObstacleClass != nullptr; }
+
+	// One mask of blocked lanes per obstacle slot, in running order
+	void SetObstacles(TConstArrayView<uint8> BlockedLanes);
+
+	// Lane spline keys in floor mesh space, shared by the spline components and headless simulation
+	static void GetLaneKeys(const FVector& FloorBounds, ETileAttachLocation AttachLocation, float LaneSpacing, ETileLane TileLane, FVector& OutBegin, FVector& OutEnd, FVector& OutBeginLeaveTangent, FVector& OutEndArriveTangent);
+	// Next attach arrow in floor mesh space, the floor mesh itself sits FloorBounds.X ahead of the root
+	static FTransform GetNextAttachKey(const FVector& FloorBounds, ETileAttachLocation AttachLocation);
+	// Distance between neighbouring lane splines
+	static float GetLaneSpacing(const FVector& FloorBounds, float LaneSpacing);
+	static float GetLaneLength(const FVector& FloorBounds, ETileAttachLocation AttachLocation, float LaneSpacing, ETileLane TileLane);
+
 	FORCEINLINE bool IsCorner() const { return E_NextAttachLocation != ETileAttachLocation::Forward; }
 
+	UFUNCTION(BlueprintPure)
+	FORCEINLINE int32 GetTileIndex() const { return TileIndex; }
+
+	FORCEINLINE void SetTileIndex(int32 NewTileIndex) { TileIndex = NewTileIndex; }
+
+	// Pooling, a released tile is hidden in place until the game mode reuses it
+	void Activate(const FTransform& Transform);
+	void Deactivate();
+
 private:
 	UFUNCTION()
 	void TileBoxBeginOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex, bool bFromSweep, const FHitResult &SweepResult);
-
-	UFUNCTION()
-	void TileBoxEndOverlap(UPrimitiveComponent* OverlappedComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, int32 OtherBodyIndex);
 	
 private:
 	void UpdateMeshComponent(UStaticMeshComponent* MeshComponent, UStaticMesh* MeshAsset, EMeshAlignment Alignment = EMeshAlignment::None);
@@ -123,7 +151,18 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Lanes", meta = (AllowPrivateAccess = "true", ClampMin = "0.25", UIMin = "0.25", ClampMax = "1", UIMax = "1"))
 	float LaneSpacingMultiplier = 1.0f;
 
+	// Evenly spaced rows along the tile that can each hold an obstacle per lane
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "*|Obstacles", meta = (AllowPrivateAccess = "true", ClampMin = "1", UIMin = "1", ClampMax = "16", UIMax = "16"))
+	int32 ObstacleSlots = 4;
+
 private:
 	UPROPERTY()
 	class ACheeseChaseGameMode* GameMode = nullptr;
+
+	// Position in the game mode's shared tile chain
+	int32 TileIndex = INDEX_NONE;
+
+	// Spawned once and kept attached, a pooled tile hides what its next layout doesn't use
+	UPROPERTY()
+	TArray<AActor*> Obstacles;
 };
@@ -0,0 +1,311 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "TrackGenerator.h"
+
+#include "CheeseChase.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Track Overlap Fallbacks"), STAT_TrackOverlapFallbacks, STATGROUP_CheeseChase);
+
+FTrackTileInfo::FTrackTileInfo(TSubclassOf<ATile> InTileClass, int32 InWeight)
+	: TileClass(InTileClass)
+	, Weight(InWeight)
+{
+	if (!TileClass) return;
+
+	const ATile* DefaultTile = TileClass->GetDefaultObject<ATile>();
+
+	bIsCorner = DefaultTile->IsCorner();
+	FloorBounds = DefaultTile->GetFloorBounds();
+	NextAttachLocation = DefaultTile->GetNextAttachLocation();
+	LaneSpacing = ATile::GetLaneSpacing(FloorBounds, DefaultTile->GetLaneSpacingMultiplier());
+	ObstacleSlots = DefaultTile->GetObstacleSlots();
+	bHasObstacles = DefaultTile->HasObstacles();
+
+	for (ETileLane TileLane : { ETileLane::Left, ETileLane::Middle, ETileLane::Right })
+	{
+		LaneLengths[static_cast<uint8>(TileLane)] = ATile::GetLaneLength(FloorBounds, NextAttachLocation, DefaultTile->GetLaneSpacingMultiplier(), TileLane);
+	}
+
+	// The floor mesh is pushed FloorBounds.X ahead of the root so tiles start at their attach point
+	FVector FloorOffset(FloorBounds.X, 0.0f, 0.0f);
+
+	Footprint = FBox(FloorOffset - FloorBounds, FloorOffset + FloorBounds);
+	NextAttachTransform = ATile::GetNextAttachKey(FloorBounds, NextAttachLocation);
+	NextAttachTransform.AddToTranslation(FloorOffset);
+}
+
+void FTrackGenerator::SetStartingTileClass(TSubclassOf<ATile> TileClass)
+{
+	StartingTile = FTrackTileInfo(TileClass, 0);
+}
+
+void FTrackGenerator::AddTileClass(TSubclassOf<ATile> TileClass, int32 Weight)
+{
+	if (!TileClass || Weight <= 0) return;
+
+	FTrackTileInfo& TileInfo = TileInfos.Emplace_GetRef(TileClass, Weight);
+	TotalWeight += Weight;
+
+	if (TileInfo.bIsCorner) return;
+
+	StraightWeight += Weight;
+
+	if (ContinuationTileIndex == INDEX_NONE || TileInfo.NextAttachTransform.GetLocation().X > TileInfos[ContinuationTileIndex].NextAttachTransform.GetLocation().X)
+	{
+		ContinuationTileIndex = TileInfos.Num() - 1;
+	}
+}
+
+void FTrackGenerator::SetOccupancyHistory(int32 InTileCount)
+{
+	OccupancyHistory = FMath::Max(InTileCount, 1);
+}
+
+float FTrackGenerator::GetShortestTileLength() const
+{
+	float ShortestLength = 0.0f;
+
+	auto FitLength = [&ShortestLength](const FTrackTileInfo& TileInfo)
+	{
+		float TileLength = TileInfo.GetLaneLength(ETileLane::Middle);
+		if (TileInfo.TileClass && TileLength > KINDA_SMALL_NUMBER) ShortestLength = ShortestLength > 0.0f ? FMath::Min(ShortestLength, TileLength) : TileLength;
+	};
+
+	FitLength(StartingTile);
+	for (const FTrackTileInfo& TileInfo : TileInfos) FitLength(TileInfo);
+
+	return ShortestLength;
+}
+
+uint32 FTrackGenerator::GetConfigHash() const
+{
+	uint32 Hash = HashCombine(GetTypeHash(OccupancyHistory), GetTypeHash(MaxCornerBuffer));
+	Hash = HashCombine(Hash, GetTypeHash(FMath::RoundToInt32(ObstacleDensity * 1000.0f)));
+
+	// Lengths are rounded to the centimetre, derived values can differ in their last bits between builds
+	auto HashTile = [&Hash](const FTrackTileInfo& TileInfo)
+	{
+		Hash = HashCombine(Hash, TileInfo.TileClass ? FCrc::StrCrc32(*TileInfo.TileClass->GetPathName()) : 0);
+		Hash = HashCombine(Hash, GetTypeHash(TileInfo.Weight));
+		Hash = HashCombine(Hash, GetTypeHash(TileInfo.ObstacleSlots * 2 + TileInfo.bHasObstacles));
+
+		for (float Value : { TileInfo.FloorBounds.X, TileInfo.FloorBounds.Y, TileInfo.LaneSpacing, TileInfo.LaneSwitchDistance })
+		{
+			Hash = HashCombine(Hash, GetTypeHash(FMath::RoundToInt32(Value)));
+		}
+	};
+
+	HashTile(StartingTile);
+	for (const FTrackTileInfo& TileInfo : TileInfos) HashTile(TileInfo);
+
+	return Hash;
+}
+
+void FTrackGenerator::SetObstacleRules(float InObstacleDensity, TFunctionRef<float(float LaneSpacing)> GetLaneSwitchDistance)
+{
+	ObstacleDensity = FMath::Clamp(InObstacleDensity, 0.0f, 1.0f);
+
+	StartingTile.LaneSwitchDistance = GetLaneSwitchDistance(StartingTile.LaneSpacing);
+	for (FTrackTileInfo& TileInfo : TileInfos) TileInfo.LaneSwitchDistance = GetLaneSwitchDistance(TileInfo.LaneSpacing);
+}
+
+void FTrackGenerator::Reset(int32 Seed, int32 InMaxCornerBuffer)
+{
+	Stream.Initialize(Seed);
+	bIsFirstTile = true;
+	MaxCornerBuffer = InMaxCornerBuffer;
+	CornerBuffer = MaxCornerBuffer;
+
+	// Cells as large as the narrowest floor keep every footprint down to a handful of cells
+	CellSize = 0.0f;
+
+	auto FitCell = [this](const FTrackTileInfo& TileInfo)
+	{
+		float TileSize = 2.0f * FMath::Min(TileInfo.FloorBounds.X, TileInfo.FloorBounds.Y);
+		if (TileSize > KINDA_SMALL_NUMBER) CellSize = CellSize > 0.0f ? FMath::Min(CellSize, TileSize) : TileSize;
+	};
+
+	FitCell(StartingTile);
+	for (const FTrackTileInfo& TileInfo : TileInfos) FitCell(TileInfo);
+
+	// Anchor cells on the starting floor so tiles of the narrowest size land on exactly one cell each
+	GridOrigin = StartingTile.TileClass ? FVector2D(StartingTile.Footprint.Min) : FVector2D::ZeroVector;
+
+	OccupiedCells.Reset();
+	TileCells.Reset();
+	TileCells.SetNum(OccupancyHistory);
+	Cursor = FTransform::Identity;
+	TileCount = 0;
+	OverlapFallbacks = 0;
+
+	ObstacleSolver.Reset();
+	Obstacles.Reset();
+}
+
+const FTrackTileInfo* FTrackGenerator::Next()
+{
+	const FTrackTileInfo* TileInfo = bIsFirstTile || TotalWeight <= 0 ? &StartingTile : PickWeighted();
+
+	if (!TileInfo->TileClass) return nullptr;
+
+	if (TileInfo->bIsCorner) CornerBuffer = MaxCornerBuffer;
+	CornerBuffer--;
+
+	Occupy(*TileInfo);
+	PlaceObstacles(*TileInfo);
+
+	bIsFirstTile = false;
+	return TileInfo;
+}
+
+const FTrackTileInfo* FTrackGenerator::PickWeighted()
+{
+	// Prefer what the corner buffer allows and fits, then what the corner buffer allows, then anything
+	TArray<int32, TInlineAllocator<16>> Weights;
+	Weights.SetNumZeroed(TileInfos.Num());
+	int32 PickWeight = 0;
+	int32 Pass = 0;
+
+	for (; Pass < 3 && PickWeight == 0; Pass++)
+	{
+		for (int32 Index = 0; Index < TileInfos.Num(); Index++)
+		{
+			const FTrackTileInfo& TileInfo = TileInfos[Index];
+
+			bool bBuffered = TileInfo.bIsCorner && CornerBuffer > 0 && StraightWeight > 0;
+			bool bAllowed = Pass == 2 || (!bBuffered && (Pass == 1 || IsPlaceable(TileInfo)));
+
+			Weights[Index] = bAllowed ? TileInfo.Weight : 0;
+			PickWeight += Weights[Index];
+		}
+	}
+
+	// Pass ends one past the pass that found something, anything after the first ignores overlaps.
+	// Only reachable when the track has boxed itself in despite the escape lookahead, so make it visible.
+	if (Pass > 1)
+	{
+		OverlapFallbacks++;
+		INC_DWORD_STAT(STAT_TrackOverlapFallbacks);
+		UE_LOG(LogCheeseChase, Warning, TEXT("Track generator found no tile that fits after %d tiles, placing an overlapping tile"), TileCount);
+	}
+
+	int32 Roll = Stream.RandRange(0, PickWeight - 1);
+
+	for (int32 Index = 0; Index < TileInfos.Num(); Index++)
+	{
+		if (Roll < Weights[Index]) return &TileInfos[Index];
+		Roll -= Weights[Index];
+	}
+
+	return &TileInfos.Last();
+}
+
+template <typename FunctorType>
+void FTrackGenerator::ForEachFootprintCell(const FTrackTileInfo& TileInfo, const FTransform& Transform, FunctorType&& Functor) const
+{
+	// Shrunk slightly so neighbouring tiles that only share an edge never share a cell
+	FBox Box = TileInfo.Footprint.TransformBy(Transform).ExpandBy(-1.0f);
+
+	int32 MinX = FMath::FloorToInt32((Box.Min.X - GridOrigin.X) / CellSize);
+	int32 MinY = FMath::FloorToInt32((Box.Min.Y - GridOrigin.Y) / CellSize);
+	int32 MaxX = FMath::FloorToInt32((Box.Max.X - GridOrigin.X) / CellSize);
+	int32 MaxY = FMath::FloorToInt32((Box.Max.Y - GridOrigin.Y) / CellSize);
+
+	for (int32 X = MinX; X <= MaxX; X++)
+	{
+		for (int32 Y = MinY; Y <= MaxY; Y++)
+		{
+			Functor(FIntPoint(X, Y));
+		}
+	}
+}
+
+bool FTrackGenerator::IsPlaceable(const FTrackTileInfo& TileInfo) const
+{
+	if (CellSize <= 0.0f) return true;
+	if (!IsFootprintFree(TileInfo, Cursor)) return false;
+	if (ContinuationTileIndex == INDEX_NONE) return true;
+
+	const FTrackTileInfo& ContinuationTile = TileInfos[ContinuationTileIndex];
+	int32 ForcedStraights = (TileInfo.bIsCorner ? MaxCornerBuffer : CornerBuffer) - 1;
+	FTransform Transform = TileInfo.NextAttachTransform * Cursor;
+
+	for (int32 Index = 0; Index < ForcedStraights; Index++)
+	{
+		if (!IsFootprintFree(ContinuationTile, Transform)) return false;
+		Transform = ContinuationTile.NextAttachTransform * Transform;
+	}
+
+	return HasEscape(ContinuationTile, Transform);
+}
+
+bool FTrackGenerator::HasEscape(const FTrackTileInfo& ContinuationTile, const FTransform& Transform) const
+{
+	// Some tile has to fit once the forced straights run out, with room for the tile after it too
+	for (const FTrackTileInfo& TileInfo : TileInfos)
+	{
+		if (IsFootprintFree(TileInfo, Transform) && IsFootprintFree(ContinuationTile, TileInfo.NextAttachTransform * Transform)) return true;
+	}
+
+	return false;
+}
+
+bool FTrackGenerator::IsFootprintFree(const FTrackTileInfo& TileInfo, const FTransform& Transform) const
+{
+	bool bFree = true;
+
+	ForEachFootprintCell(TileInfo, Transform, [this, &bFree](const FIntPoint& Cell)
+	{
+		bFree &= !OccupiedCells.Contains(Cell);
+	});
+
+	return bFree;
+}
+
+void FTrackGenerator::Occupy(const FTrackTileInfo& TileInfo)
+{
+	TArray<FIntPoint>& Cells = TileCells[TileCount % OccupancyHistory];
+
+	// Drop the footprint that fell out of the history, unless a newer tile has claimed the cell since
+	int32 EvictedTile = TileCount - OccupancyHistory;
+	for (const FIntPoint& Cell : Cells)
+	{
+		const int32* Owner = OccupiedCells.Find(Cell);
+		if (Owner && *Owner == EvictedTile) OccupiedCells.Remove(Cell);
+	}
+
+	Cells.Reset();
+
+	if (CellSize > 0.0f)
+	{
+		ForEachFootprintCell(TileInfo, Cursor, [this, &Cells](const FIntPoint& Cell)
+		{
+			OccupiedCells.Add(Cell, TileCount);
+			Cells.Add(Cell);
+		});
+	}
+
+	Cursor = TileInfo.NextAttachTransform * Cursor;
+	TileCount++;
+}
+
+void FTrackGenerator::PlaceObstacles(const FTrackTileInfo& TileInfo)
+{
+	Obstacles.Reset();
+	Obstacles.SetNumZeroed(FMath::Max(TileInfo.ObstacleSlots, 1));
+
+	// The starting tile is always clear, tiles without an obstacle mesh still count as open road for the solver
+	if (!bIsFirstTile && TileInfo.bHasObstacles && ObstacleDensity > 0.0f)
+	{
+		for (uint8& SlotBlocked : Obstacles)
+		{
+			for (int32 Lane = 0; Lane < 3; Lane++)
+			{
+				if (Stream.FRand() < ObstacleDensity) SlotBlocked |= 1 << Lane;
+			}
+		}
+	}
+
+	ObstacleSolver.Commit(TileInfo.GetLaneLength(ETileLane::Middle) / Obstacles.Num(), TileInfo.LaneSwitchDistance, Obstacles);
+}
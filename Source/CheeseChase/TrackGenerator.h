@@ -0,0 +1,108 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Math/RandomStream.h"
+#include "ObstacleSolver.h"
+#include "Tile.h"
+
+// Everything generation and simulation need from a tile class, read once from its defaults
+struct CHEESECHASE_API FTrackTileInfo
+{
+	FTrackTileInfo() = default;
+	FTrackTileInfo(TSubclassOf<ATile> InTileClass, int32 InWeight);
+
+	FORCEINLINE float GetLaneLength(ETileLane TileLane) const { return LaneLengths[static_cast<uint8>(TileLane)]; }
+
+	TSubclassOf<ATile> TileClass;
+	int32 Weight = 0;
+	bool bIsCorner = false;
+	FVector FloorBounds = FVector::ZeroVector;
+	ETileAttachLocation NextAttachLocation = ETileAttachLocation::Forward;
+	float LaneLengths[3] = {};
+	float LaneSpacing = 0.0f;
+
+	// Track distance a lane change keeps the runner in both lanes, see ACheeseChaseCharacter::GetLaneSwitchDistance
+	float LaneSwitchDistance = 0.0f;
+	int32 ObstacleSlots = 0;
+	bool bHasObstacles = false;
+
+	// Floor footprint and next attach transform relative to the tile root
+	FBox Footprint = FBox(ForceInit);
+	FTransform NextAttachTransform = FTransform::Identity;
+};
+
+// Seeded tile class sequence shared by the game mode and headless run verification.
+// Once configured it never touches UObjects, so copies can be stepped on any thread.
+class CHEESECHASE_API FTrackGenerator
+{
+public:
+	void SetStartingTileClass(TSubclassOf<ATile> TileClass);
+	void AddTileClass(TSubclassOf<ATile> TileClass, int32 Weight);
+	void SetOccupancyHistory(int32 TileCount);
+	// Call once every tile class is added, lane switch distances are worked out per tile from its lane spacing
+	void SetObstacleRules(float InObstacleDensity, TFunctionRef<float(float LaneSpacing)> GetLaneSwitchDistance);
+	void Reset(int32 Seed, int32 InMaxCornerBuffer);
+	FORCEINLINE void Reseed(int32 Seed) { Reset(Seed, MaxCornerBuffer); }
+
+	// Next tile in the sequence, nullptr if nothing can be generated
+	const FTrackTileInfo* Next();
+
+	// Blocked lane masks per obstacle slot of the tile last returned by Next, already made passable
+	FORCEINLINE TConstArrayView<uint8> GetObstacles() const { return Obstacles; }
+
+	// Times no tile fitted and an overlapping one had to be placed
+	FORCEINLINE int32 GetOverlapFallbacks() const { return OverlapFallbacks; }
+
+	// Tiles kept from overlapping, anything older than this can be generated over
+	FORCEINLINE int32 GetOccupancyHistory() const { return OccupancyHistory; }
+
+	// Shortest middle lane of any tile the sequence can produce, zero if none are configured
+	float GetShortestTileLength() const;
+
+	// Hash of everything the layout depends on apart from the seed, stable between processes
+	uint32 GetConfigHash() const;
+
+private:
+	const FTrackTileInfo* PickWeighted();
+
+	// Whether the tile and the straights the corner buffer forces after it all fit in free cells,
+	// with a way on from the end of them so the track can't spiral into a pocket
+	bool IsPlaceable(const FTrackTileInfo& TileInfo) const;
+	bool IsFootprintFree(const FTrackTileInfo& TileInfo, const FTransform& Transform) const;
+	bool HasEscape(const FTrackTileInfo& ContinuationTile, const FTransform& Transform) const;
+	void Occupy(const FTrackTileInfo& TileInfo);
+	void PlaceObstacles(const FTrackTileInfo& TileInfo);
+
+	template <typename FunctorType>
+	void ForEachFootprintCell(const FTrackTileInfo& TileInfo, const FTransform& Transform, FunctorType&& Functor) const;
+
+private:
+	FTrackTileInfo StartingTile;
+	TArray<FTrackTileInfo> TileInfos;
+	int32 TotalWeight = 0;
+	int32 StraightWeight = 0;
+
+	// Longest straight class, used as the envelope for forced continuations
+	int32 ContinuationTileIndex = INDEX_NONE;
+
+	FRandomStream Stream;
+	bool bIsFirstTile = true;
+	int32 MaxCornerBuffer = 0;
+	int32 CornerBuffer = 0;
+
+	// Sparse grid of the last OccupancyHistory footprints in track space, cell to tile number
+	TMap<FIntPoint, int32> OccupiedCells;
+	TArray<TArray<FIntPoint>> TileCells;
+	FTransform Cursor = FTransform::Identity;
+	int32 TileCount = 0;
+	int32 OccupancyHistory = 64;
+	float CellSize = 0.0f;
+	int32 OverlapFallbacks = 0;
+	FVector2D GridOrigin = FVector2D::ZeroVector;
+
+	FObstacleSolver ObstacleSolver;
+	TArray<uint8, TInlineAllocator<16>> Obstacles;
+	float ObstacleDensity = 0.0f;
+};
@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "VerifyRunsCommandlet.h"
+
+#include "CheeseChase.h"
+#include "CheeseChaseCharacter.h"
+#include "CheeseChaseGameMode.h"
+#include "RunRecord.h"
+#include "RunVerifier.h"
+#include "Async/ParallelFor.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "HAL/FileManager.h"
+
+
+UVerifyRunsCommandlet::UVerifyRunsCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UVerifyRunsCommandlet::Main(const FString& Params)
+{
+	FString RunsDirectory;
+	FString GameModePath;
+	float Tolerance = 0.02f;
+
+	if (!FParse::Value(*Params, TEXT("Runs="), RunsDirectory) || !FParse::Value(*Params, TEXT("GameMode="), GameModePath))
+	{
+		UE_LOG(LogCheeseChase, Error, TEXT("Usage: -run=VerifyRuns -Runs=<Directory> -GameMode=<GameModeClassPath> [-Tolerance=0.02]"));
+		return 1;
+	}
+
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+
+	UClass* GameModeClass = LoadClass<ACheeseChaseGameMode>(nullptr, *GameModePath);
+	if (!GameModeClass)
+	{
+		UE_LOG(LogCheeseChase, Error, TEXT("Could not load game mode %s"), *GameModePath);
+		return 1;
+	}
+
+	const ACheeseChaseGameMode* GameMode = GameModeClass->GetDefaultObject<ACheeseChaseGameMode>();
+	const ACheeseChaseCharacter* Character = GameMode->DefaultPawnClass ? Cast<ACheeseChaseCharacter>(GameMode->DefaultPawnClass->GetDefaultObject()) : nullptr;
+	if (!Character)
+	{
+		UE_LOG(LogCheeseChase, Error, TEXT("%s does not use a CheeseChase character"), *GameModePath);
+		return 1;
+	}
+
+	// Everything is read from class defaults up front, the verifier itself never touches a UObject
+	FRunVerifier Verifier(GameMode->CreateTrackGenerator(0), Character->GetCharacterMovement()->MaxWalkSpeed, Tolerance);
+
+	TArray<FString> RunFiles;
+	IFileManager::Get().FindFiles(RunFiles, *(RunsDirectory / (FString(TEXT("*")) + FRunRecord::FileExtension)), true, false);
+
+	TArray<FRunVerification> Results;
+	Results.SetNum(RunFiles.Num());
+
+	double StartTime = FPlatformTime::Seconds();
+
+	ParallelFor(RunFiles.Num(), [&](int32 Index)
+	{
+		FRunRecord Run;
+
+		if (!Run.LoadFromFile(RunsDirectory / RunFiles[Index]))
+		{
+			Results[Index].Error = TEXT("Could not read run");
+			return;
+		}
+
+		Results[Index] = Verifier.Verify(Run);
+	});
+
+	double ElapsedTime = FPlatformTime::Seconds() - StartTime;
+	int32 VerifiedCount = 0;
+
+	for (int32 Index = 0; Index < RunFiles.Num(); Index++)
+	{
+		if (Results[Index].bVerified)
+		{
+			VerifiedCount++;
+			continue;
+		}
+
+		UE_LOG(LogCheeseChase, Warning, TEXT("%s failed verification: %s"), *RunFiles[Index], *Results[Index].Error);
+	}
+
+	UE_LOG(LogCheeseChase, Display, TEXT("Verified %d of %d runs in %.3fs (%.0f runs/s)"), VerifiedCount, RunFiles.Num(), ElapsedTime, RunFiles.Num() / FMath::Max(ElapsedTime, UE_DOUBLE_SMALL_NUMBER));
+
+	return VerifiedCount == RunFiles.Num() ? 0 : 1;
+}
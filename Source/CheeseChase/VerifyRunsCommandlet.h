@@ -0,0 +1,22 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "VerifyRunsCommandlet.generated.h"
+
+/**
+ * Re-simulates every recorded run in a directory and checks the claimed distance and score.
+ * -run=VerifyRuns -Runs=<Directory> -GameMode=<GameModeClassPath> [-Tolerance=0.02]
+ */
+UCLASS()
+class UVerifyRunsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UVerifyRunsCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};